@@ -4,41 +4,113 @@
 import socket
 import struct
 import sys
-import time
+import threading
 
 try:
     from urlparse import urlparse
 except ImportError:
     from urllib.parse import urlparse
 
-if len(sys.argv) < 3:
-    print('Usage: ' + sys.argv[0] + ' <target ip> <url>...')
-    sys.exit(1)
+def parse_targets(spec):
+    # Accepts a comma-separated list of IPs and/or IPv4 subnets, e.g. 192.168.1.20,192.168.2.0/24.
+    targets = []
+    subnet = False
+    for part in spec.split(','):
+        part = part.strip()
+        if part == '':
+            continue
 
-target_ip = sys.argv[1]
-file_list_payload = ''
+        if '/' in part:
+            subnet = True
+            base, bits = part.split('/', 1)
+            bits = int(bits)
+            mask = (0xFFFFFFFF << (32 - bits)) & 0xFFFFFFFF
+            network = struct.unpack('!L', socket.inet_aton(base))[0] & mask
+            count = 1 << (32 - bits)
+            first, last = (network + 1, network + count - 1) if count > 2 else (network, network + count)
+            for host in range(first, last):
+                targets.append(socket.inet_ntoa(struct.pack('!L', host)))
+        else:
+            targets.append(part)
 
-for url in sys.argv[2:]:
-    parsed = urlparse(url);
-    if not parsed.scheme in ('http', 'https') or parsed.netloc == '':
-        print(url + ': Invalid URL')
+    return targets, subnet
+
+def push_to_target(target, payload, connect_timeout, results):
+    try:
+        sock = socket.create_connection((target, 5000), connect_timeout)
+    except Exception as e:
+        # Subnet scans expect most addresses not to be consoles.
+        results[target] = None if connect_timeout is not None else 'failed: ' + str(e)
+        return
+
+    try:
+        sock.settimeout(None)
+        sock.sendall(struct.pack('!L', len(payload)) + payload)
+
+        # FBI sends a single byte once it is done with the URLs.
+        results[target] = 'done' if len(sock.recv(1)) == 1 else 'disconnected'
+    except Exception as e:
+        results[target] = 'failed: ' + str(e)
+    finally:
+        sock.close()
+
+def main():
+    if len(sys.argv) < 3:
+        print('Usage: ' + sys.argv[0] + ' <target ip(s)> <url>...')
         sys.exit(1)
 
-    file_list_payload += url + '\n'
+    target_ip = sys.argv[1]
+    file_list_payload = ''
 
-file_list_payloadBytes = file_list_payload.encode('ascii')
+    for url in sys.argv[2:]:
+        parsed = urlparse(url);
+        if not parsed.scheme in ('http', 'https') or parsed.netloc == '':
+            print(url + ': Invalid URL')
+            sys.exit(1)
 
-print('URLs:')
-print(file_list_payload)
+        file_list_payload += url + '\n'
 
-try:
-    print('Sending URL(s) to '+ target_ip + ' on port 5000...')
-    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
-    sock.connect((target_ip, 5000))
-    sock.sendall(struct.pack('!L', len(file_list_payloadBytes)) + file_list_payloadBytes)
-    while len(sock.recv(1)) < 1:
-        time.sleep(0.05)
-    sock.close()
-except Exception as e:
-    print('An error occurred: ' + str(e))
-    sys.exit(1)
+    file_list_payloadBytes = file_list_payload.encode('ascii')
+
+    print('URLs:')
+    print(file_list_payload)
+
+    targets, subnet = parse_targets(target_ip)
+    if len(targets) == 0:
+        print('No targets specified.')
+        sys.exit(1)
+
+    results = {}
+
+    if len(targets) == 1 and not subnet:
+        print('Sending URL(s) to '+ targets[0] + ' on port 5000...')
+        push_to_target(targets[0], file_list_payloadBytes, None, results)
+
+        if results[targets[0]] not in ('done', 'disconnected'):
+            print('An error occurred: ' + results[targets[0]])
+            sys.exit(1)
+    else:
+        print('Sending URL(s) to ' + str(len(targets)) + ' target(s) on port 5000...')
+
+        workers = [threading.Thread(target=push_to_target, args=(target, file_list_payloadBytes, 2 if subnet else None, results)) for target in targets]
+        for worker in workers:
+            worker.start()
+
+        for worker in workers:
+            worker.join()
+
+        failed = False
+
+        print('\n%-16s %s' % ('Target', 'Result'))
+        for target in sorted(results):
+            if results[target] is not None:
+                print('%-16s %s' % (target, results[target]))
+
+                if results[target] not in ('done', 'disconnected'):
+                    failed = True
+
+        if failed:
+            sys.exit(1)
+
+if __name__ == '__main__':
+    main()
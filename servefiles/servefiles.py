@@ -1,6 +1,9 @@
 #!/usr/bin/env python
 # coding: utf-8 -*-
 
+import gzip
+import hashlib
+import json
 import os
 import socket
 import struct
@@ -9,34 +12,53 @@ import threading
 import time
 import urllib
 
+from io import BytesIO
+
+from sendurls import parse_targets
+
 try:
     from SimpleHTTPServer import SimpleHTTPRequestHandler
-    from SocketServer import TCPServer
+    from SocketServer import TCPServer, ThreadingMixIn
     from urllib import quote
     input = raw_input
 except ImportError:
     from http.server import SimpleHTTPRequestHandler
-    from socketserver import TCPServer
+    from socketserver import TCPServer, ThreadingMixIn
     from urllib.parse import quote
 
 interactive = False
+
+# Opt-in: serve gzip-compressed copies of files to clients that accept them.
+compress = '--compress' in sys.argv
+if compress:
+    sys.argv.remove('--compress')
+
+# Opt-in: send FBI the URL of a manifest instead of the URL list. Only FBI builds that understand the manifest
+# can install from it; older ones need the plain list.
+use_manifest = '--manifest' in sys.argv
+if use_manifest:
+    sys.argv.remove('--manifest')
     
 if len(sys.argv) <= 2:
     # If there aren't enough variables, use interactive mode
     if len(sys.argv) == 2:
         if sys.argv[1].lower() in ('--help', '-help', 'help', 'h', '-h', '--h'):
-            print('Usage: ' + sys.argv[0] + ' <target ip> <file / directory> [host ip] [host port]')
+            print('Usage: ' + sys.argv[0] + ' [--compress] [--manifest] <target ip(s)> <file / directory> [host ip] [host port]')
             sys.exit(1)
     
     interactive = True
 
 elif len(sys.argv) < 3 or len(sys.argv) > 6:
-    print('Usage: ' + sys.argv[0] + ' <target ip> <file / directory> [host ip] [host port]')
+    print('Usage: ' + sys.argv[0] + ' [--compress] [--manifest] <target ip(s)> <file / directory> [host ip] [host port]')
     sys.exit(1)
 
 accepted_extension = ('.cia', '.tik', '.cetk', '.3dsx')
 hostPort = 8080 # Default value
 
+manifest_name = 'fbi-manifest.json'
+manifest_cache_path = os.path.join(os.path.expanduser('~'), '.servefiles_cache.json')
+compress_cache_dir = os.path.join(os.path.expanduser('~'), '.servefiles_cache')
+
 if interactive:
     target_ip = input("The IP of your 3DS: ")
     target_path = input("The file you want to send (.cia, .tik, .cetk, or .3dsx): ")
@@ -84,27 +106,158 @@ if not os.path.exists(target_path):
     sys.exit(1)
 
 
+sig_sizes = {0x10000: 0x240, 0x10001: 0x140, 0x10002: 0x80, 0x10003: 0x240, 0x10004: 0x140, 0x10005: 0x80}
+
+def align64(value):
+    return (value + 0x3F) & ~0x3F
+
+def read_title_info(path):
+    # Only the CIA/ticket headers are read; anything unparseable just has no title info.
+    try:
+        with open(path, 'rb') as f:
+            if path.endswith('.cia'):
+                header = f.read(0x20)
+                header_size, _, _, cert_size, ticket_size = struct.unpack('<IHHII', header[0:16])
+                f.seek(align64(header_size) + align64(cert_size) + align64(ticket_size))
+            elif not path.endswith(('.tik', '.cetk')):
+                return None
+
+            sig_type = struct.unpack('>I', f.read(4))[0]
+            if sig_type not in sig_sizes:
+                return None
+
+            body = f.read(sig_sizes[sig_type] - 4 + 0xA4)
+            offset = sig_sizes[sig_type] - 4
+            if path.endswith('.cia'):
+                title_id, = struct.unpack('>Q', body[offset + 0x4C:offset + 0x54])
+                version, = struct.unpack('>H', body[offset + 0x9C:offset + 0x9E])
+            else:
+                title_id, = struct.unpack('>Q', body[offset + 0x9C:offset + 0xA4])
+                version = None
+
+            return ('%016X' % title_id, version)
+    except (IOError, struct.error):
+        return None
+
+def load_manifest_cache():
+    try:
+        with open(manifest_cache_path, 'r') as f:
+            return json.load(f)
+    except (IOError, ValueError):
+        return {}
+
+def save_manifest_cache(cache):
+    try:
+        with open(manifest_cache_path, 'w') as f:
+            json.dump(cache, f)
+    except IOError as e:
+        print('Failed to save manifest cache: ' + str(e))
+
+def build_manifest(directory, files):
+    cache = load_manifest_cache()
+    entries = []
+
+    for file in files:
+        path = os.path.abspath(os.path.join(directory, file))
+        stat = os.stat(path)
+
+        cached = cache.get(path)
+        if cached is None or cached.get('size') != stat.st_size or cached.get('mtime') != stat.st_mtime:
+            sha256 = hashlib.sha256()
+            with open(path, 'rb') as f:
+                for chunk in iter(lambda: f.read(1024 * 1024), b''):
+                    sha256.update(chunk)
+
+            cached = {'size': stat.st_size, 'mtime': stat.st_mtime, 'sha256': sha256.hexdigest(), 'title': read_title_info(path)}
+            cache[path] = cached
+
+        entry = {'url': quote(file), 'size': cached['size'], 'sha256': cached['sha256']}
+        if cached['title'] is not None:
+            entry['titleId'] = cached['title'][0]
+            if cached['title'][1] is not None:
+                entry['titleVersion'] = cached['title'][1]
+
+        entries.append(entry)
+
+    save_manifest_cache(cache)
+
+    return json.dumps({'version': 1, 'files': entries}).encode('ascii')
+
+def build_compressed(directory, files):
+    if not os.path.isdir(compress_cache_dir):
+        os.makedirs(compress_cache_dir)
+
+    compressed = {}
+    for file in files:
+        path = os.path.abspath(os.path.join(directory, file))
+        stat = os.stat(path)
+
+        # Keyed by path, size and modification time so stale copies are never served.
+        key = hashlib.sha1((path + ':' + str(stat.st_size) + ':' + str(stat.st_mtime)).encode('utf-8')).hexdigest()
+        cache_path = os.path.join(compress_cache_dir, key + '.gz')
+
+        if not os.path.isfile(cache_path):
+            print('Compressing ' + file + '...')
+            with open(path, 'rb') as src:
+                temp_path = cache_path + '.tmp'
+                with open(temp_path, 'wb') as raw:
+                    # Level 1 keeps compression fast; most savings come from zero padding anyway.
+                    with gzip.GzipFile(filename='', mode='wb', compresslevel=1, fileobj=raw, mtime=0) as dst:
+                        for chunk in iter(lambda: src.read(1024 * 1024), b''):
+                            dst.write(chunk)
+
+                os.rename(temp_path, cache_path)
+
+        # Only bother when it actually saves bytes on the wire.
+        if os.path.getsize(cache_path) < stat.st_size * 0.95:
+            compressed[path] = cache_path
+
+    return compressed
+
 print('Preparing data...')
 baseUrl = hostIp + ':' + str(hostPort) + '/'
+manifest_bytes = None
+compressed_files = {}
 
 if os.path.isfile(target_path):
     if target_path.endswith(accepted_extension):
         file_list_payload = baseUrl + quote(os.path.basename(target_path))
         directory = os.path.dirname(target_path)  # get file directory
+        files = [os.path.basename(target_path)]
     else:
         print('Unsupported file extension. Supported extensions are: ' + accepted_extension)
         sys.exit(1)
 
 else:
     directory = target_path  # it's a directory
-    file_list_payload = ''  # init the payload before adding lines
-    for file in [file for file in next(os.walk(target_path))[2] if file.endswith(accepted_extension)]:
-        file_list_payload += baseUrl + quote(file) + '\n'
+    files = []
+    for root, dirs, names in os.walk(target_path):
+        dirs.sort()
+        for name in sorted(names):
+            if name.endswith(accepted_extension):
+                files.append(os.path.relpath(os.path.join(root, name), target_path).replace(os.sep, '/'))
+
+    file_list_payload = ''
+    if len(files) > 0:
+        if use_manifest:
+            print('Hashing ' + str(len(files)) + ' file(s)...')
+            manifest_bytes = build_manifest(directory, files)
+
+            # FBI fetches the manifest and plans the batch from it.
+            file_list_payload = baseUrl + manifest_name
+        else:
+            file_list_payload = '\n'.join(baseUrl + quote(file) for file in files)
+
+        print('\nFiles:')
+        print('\n'.join(files))
 
 if len(file_list_payload) == 0:
     print('No files to serve.')
     sys.exit(1)
 
+if compress:
+    compressed_files = build_compressed(directory, files)
+
 file_list_payloadBytes = file_list_payload.encode('ascii')
 
 if directory and directory != '.':  # doesn't need to move if it's already the current working directory
@@ -113,29 +266,238 @@ if directory and directory != '.':  # doesn't need to move if it's already the c
 print('\nURLs:')
 print(file_list_payload + '\n')
 
-class MyServer(TCPServer):
+class ServeFilesHandler(SimpleHTTPRequestHandler):
+    # HTTP/1.1 allows FBI to keep its connection alive between requests.
+    protocol_version = 'HTTP/1.1'
+
+    def send_head(self):
+        self.range = None
+
+        if manifest_bytes is not None and self.path == '/' + manifest_name:
+            self.send_response(200)
+            self.send_header('Content-Type', 'application/json')
+            self.send_header('Content-Length', str(len(manifest_bytes)))
+            self.end_headers()
+            return BytesIO(manifest_bytes)
+
+        path = self.translate_path(self.path)
+        if os.path.isdir(path):
+            return SimpleHTTPRequestHandler.send_head(self)
+
+        compressed_path = compressed_files.get(os.path.abspath(path))
+        if compressed_path is not None and self.headers.get('Range') is None and 'gzip' in self.headers.get('Accept-Encoding', ''):
+            f = open(compressed_path, 'rb')
+            size = os.fstat(f.fileno()).st_size
+
+            self.send_response(200)
+            self.send_header('Content-Type', self.guess_type(path))
+            self.send_header('Content-Encoding', 'gzip')
+            self.send_header('Content-Length', str(size))
+            self.send_header('Vary', 'Accept-Encoding')
+            self.end_headers()
+
+            self.range = (0, size - 1)
+            return f
+
+        try:
+            f = open(path, 'rb')
+        except IOError:
+            self.send_error(404, 'File not found')
+            return None
+
+        try:
+            size = os.fstat(f.fileno()).st_size
+
+            start = 0
+            end = size - 1
+            partial = False
+
+            range_header = self.headers.get('Range')
+            if range_header is not None and range_header.startswith('bytes=') and ',' not in range_header:
+                first, _, last = range_header[6:].strip().partition('-')
+                try:
+                    if first == '':
+                        start = max(size - int(last), 0)
+                    else:
+                        start = int(first)
+                        if last != '':
+                            end = min(int(last), size - 1)
+                except ValueError:
+                    start = 0
+                    end = size - 1
+                else:
+                    if start >= size or start > end:
+                        f.close()
+                        self.send_response(416)
+                        self.send_header('Content-Range', 'bytes */' + str(size))
+                        self.send_header('Content-Length', '0')
+                        self.end_headers()
+                        return None
+
+                    partial = True
+
+            if partial:
+                self.send_response(206)
+                self.send_header('Content-Range', 'bytes ' + str(start) + '-' + str(end) + '/' + str(size))
+            else:
+                self.send_response(200)
+
+            self.send_header('Content-Type', self.guess_type(path))
+            self.send_header('Content-Length', str(end - start + 1))
+            self.send_header('Accept-Ranges', 'bytes')
+            self.send_header('Last-Modified', self.date_time_string(os.fstat(f.fileno()).st_mtime))
+            self.end_headers()
+
+            self.range = (start, end)
+            return f
+        except:
+            f.close()
+            raise
+
+    def copyfile(self, source, outputfile):
+        if self.range is None:
+            SimpleHTTPRequestHandler.copyfile(self, source, outputfile)
+            return
+
+        start, end = self.range
+        remaining = end - start + 1
+        sent = 0
+        began = time.time()
+
+        outputfile.flush()
+
+        if hasattr(os, 'sendfile'):
+            # Zero-copy path: the kernel moves file pages straight to the socket.
+            out_fd = self.connection.fileno()
+            in_fd = source.fileno()
+            while remaining > 0:
+                count = os.sendfile(out_fd, in_fd, start + sent, min(remaining, 1024 * 1024))
+                if count == 0:
+                    break
+
+                sent += count
+                remaining -= count
+                record_sent(self.client_address[0], count)
+        else:
+            source.seek(start)
+            while remaining > 0:
+                buf = source.read(min(remaining, 64 * 1024))
+                if not buf:
+                    break
+
+                outputfile.write(buf)
+                sent += len(buf)
+                remaining -= len(buf)
+                record_sent(self.client_address[0], len(buf))
+
+        if remaining == 0:
+            record_file(self.client_address[0])
+
+        elapsed = max(time.time() - began, 0.001)
+        self.log_message('sent %s: %d bytes in %.2fs (%.2f MB/s)', self.path, sent, elapsed, sent / elapsed / (1024 * 1024))
+
+
+class ServeFilesServer(ThreadingMixIn, TCPServer):
+    # Each console gets its own thread, so several can download at once.
+    daemon_threads = True
+    allow_reuse_address = True
+
     def server_bind(self):
-        import socket
         self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
         self.socket.bind(self.server_address)
 
+target_stats = {}
+target_stats_lock = threading.Lock()
+
+def set_status(target, status):
+    with target_stats_lock:
+        target_stats.setdefault(target, {'status': '', 'files': 0, 'sent': 0})['status'] = status
+
+def record_sent(client, count):
+    with target_stats_lock:
+        if client in target_stats:
+            target_stats[client]['sent'] += count
+
+def record_file(client):
+    with target_stats_lock:
+        if client in target_stats:
+            target_stats[client]['files'] += 1
+
+def print_table():
+    with target_stats_lock:
+        rows = [(target, dict(stats)) for target, stats in sorted(target_stats.items()) if stats['status'] != 'unreachable']
+
+    print('\n%-16s %-24s %6s %12s' % ('Target', 'Status', 'Files', 'Sent'))
+    for target, stats in rows:
+        print('%-16s %-24s %6d %9.2f MB' % (target, stats['status'][:24], stats['files'], stats['sent'] / (1024.0 * 1024.0)))
+
+def push_to_target(target, connect_timeout):
+    set_status(target, 'connecting')
+    try:
+        sock = socket.create_connection((target, 5000), connect_timeout)
+    except Exception as e:
+        # Subnet scans expect most addresses not to be consoles.
+        set_status(target, 'unreachable' if connect_timeout is not None else 'failed: ' + str(e))
+        return
+
+    try:
+        sock.settimeout(None)
+        sock.sendall(struct.pack('!L', len(file_list_payloadBytes)) + file_list_payloadBytes)
+        set_status(target, 'installing')
+
+        # FBI sends a single byte once it is done with the URLs.
+        set_status(target, 'done' if len(sock.recv(1)) == 1 else 'disconnected')
+    except Exception as e:
+        set_status(target, 'failed: ' + str(e))
+    finally:
+        sock.close()
+
+targets, subnet = parse_targets(target_ip)
+if len(targets) == 0:
+    print('No targets specified.')
+    sys.exit(1)
+
 print('Opening HTTP server on port ' + str(hostPort))
-server = MyServer(('', hostPort), SimpleHTTPRequestHandler)
+server = ServeFilesServer(('', hostPort), ServeFilesHandler)
 thread = threading.Thread(target=server.serve_forever)
 thread.start()
 
-try:
-    print('Sending URL(s) to ' + target_ip + ' on port 5000...')
-    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
-    sock.connect((target_ip, 5000))
-    sock.sendall(struct.pack('!L', len(file_list_payloadBytes)) + file_list_payloadBytes)
-    while len(sock.recv(1)) < 1:
-        time.sleep(0.05)
-    sock.close()
-except Exception as e:
-    print('An error occurred: ' + str(e))
-    server.shutdown()
-    sys.exit(1)
+if len(targets) == 1 and not subnet:
+    print('Sending URL(s) to ' + targets[0] + ' on port 5000...')
+    push_to_target(targets[0], None)
+
+    status = target_stats[targets[0]]['status']
+    if status != 'done' and status != 'disconnected':
+        print('An error occurred: ' + status)
+        server.shutdown()
+        sys.exit(1)
+else:
+    print('Sending URL(s) to ' + str(len(targets)) + ' target(s) on port 5000...')
+
+    # All consoles share this one server and its file cache.
+    workers = [threading.Thread(target=push_to_target, args=(target, 2 if subnet else None)) for target in targets]
+    for worker in workers:
+        worker.daemon = True
+        worker.start()
+
+    last_report = time.time()
+    while any(worker.is_alive() for worker in workers):
+        time.sleep(0.1)
+
+        if time.time() - last_report >= 5:
+            print_table()
+            last_report = time.time()
+
+    print_table()
+
+failed = False
+with target_stats_lock:
+    for stats in target_stats.values():
+        if stats['status'] not in ('done', 'disconnected', 'unreachable'):
+            failed = True
 
 print('Shutting down HTTP server...')
 server.shutdown()
+
+if failed:
+    sys.exit(1)
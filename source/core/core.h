@@ -7,6 +7,7 @@
 #include "clipboard.h"
 #include "error.h"
 #include "fs.h"
+#include "grayscale.h"
 #include "http.h"
 #include "linkedlist.h"
 #include "screen.h"
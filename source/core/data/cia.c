@@ -5,7 +5,7 @@
 #include "tmd.h"
 #include "../error.h"
 
-Result cia_get_title_id(u64* titleId, u8* cia, size_t size) {
+static Result cia_get_tmd(u8** tmd, size_t* tmdSize, u8* cia, size_t size) {
     if(cia == NULL) {
         return R_APP_INVALID_ARGUMENT;
     }
@@ -23,7 +23,31 @@ Result cia_get_title_id(u64* titleId, u8* cia, size_t size) {
         return R_APP_BAD_DATA;
     }
 
-    return tmd_get_title_id(titleId, &cia[offset], size - offset);
+    *tmd = &cia[offset];
+    *tmdSize = size - offset;
+    return 0;
+}
+
+Result cia_get_title_id(u64* titleId, u8* cia, size_t size) {
+    u8* tmd = NULL;
+    size_t tmdSize = 0;
+    Result res = cia_get_tmd(&tmd, &tmdSize, cia, size);
+    if(R_FAILED(res)) {
+        return res;
+    }
+
+    return tmd_get_title_id(titleId, tmd, tmdSize);
+}
+
+Result cia_get_title_version(u16* titleVersion, u8* cia, size_t size) {
+    u8* tmd = NULL;
+    size_t tmdSize = 0;
+    Result res = cia_get_tmd(&tmd, &tmdSize, cia, size);
+    if(R_FAILED(res)) {
+        return res;
+    }
+
+    return tmd_get_title_version(titleVersion, tmd, tmdSize);
 }
 
 Result cia_file_get_smdh(SMDH* smdh, Handle handle) {
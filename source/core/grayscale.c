@@ -0,0 +1,14 @@
+#include <3ds.h>
+
+#include "grayscale.h"
+
+// Average of the 8-bit expanded RGB565 channels; the sum is at most 748, for which
+// (sum * 0x5556) >> 16 matches sum / 3 exactly.
+#define GRAY_FROM_SUM(sum) ((u8) (((sum) * 0x5556) >> 16))
+
+void grayscale_convert_rgb565_row(u8* dst, const u16* src, int width) {
+    for(int x = 0; x < width; x++) {
+        u32 px = src[x];
+        dst[x] = GRAY_FROM_SUM((((px >> 11) & 0x1F) << 3) + (((px >> 5) & 0x3F) << 2) + ((px & 0x1F) << 3));
+    }
+}
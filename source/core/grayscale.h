@@ -0,0 +1,3 @@
+#pragma once
+
+void grayscale_convert_rgb565_row(u8* dst, const u16* src, int width);
@@ -24,6 +24,7 @@ struct httpc_context_s {
     httpcContext httpc;
 
     bool compressed;
+    bool inflateFinished;
     z_stream inflate;
     u8 buffer[32 * 1024];
     u32 bufferSize;
@@ -165,6 +166,11 @@ static Result httpc_get_size(httpc_context context, u32* size) {
     return httpcGetDownloadSizeState(&context->httpc, NULL, size);
 }
 
+static bool httpc_is_finished(httpc_context context, u32 total, u32 size) {
+    // Compressed bodies are complete when the stream ends, as size is the encoded length.
+    return context->compressed ? context->inflateFinished : total >= size;
+}
+
 static Result httpc_read(httpc_context context, u32* bytesRead, void* buffer, u32 size) {
     if(context == NULL || buffer == NULL) {
         return R_APP_INVALID_ARGUMENT;
@@ -178,30 +184,41 @@ static Result httpc_read(httpc_context context, u32* bytesRead, void* buffer, u3
 
         u32 outPos = 0;
         if(context->compressed) {
-            u32 lastPos = context->bufferSize;
-            while(res == HTTPC_RESULTCODE_DOWNLOADPENDING && outPos < size) {
-                if((context->bufferSize > 0
-                    || R_SUCCEEDED(res = httpcReceiveDataTimeout(&context->httpc, &context->buffer[context->bufferSize], sizeof(context->buffer) - context->bufferSize, HTTP_TIMEOUT_NS))
-                    || res == HTTPC_RESULTCODE_DOWNLOADPENDING)) {
+            u32 lastPos = startPos;
+            while(outPos < size && !context->inflateFinished) {
+                if(res == HTTPC_RESULTCODE_DOWNLOADPENDING && context->bufferSize < sizeof(context->buffer)) {
+                    if(R_FAILED(res = httpcReceiveDataTimeout(&context->httpc, &context->buffer[context->bufferSize], sizeof(context->buffer) - context->bufferSize, HTTP_TIMEOUT_NS)) && res != HTTPC_RESULTCODE_DOWNLOADPENDING) {
+                        break;
+                    }
+
                     Result posRes = 0;
                     u32 currPos = 0;
-                    if(R_SUCCEEDED(posRes = httpcGetDownloadSizeState(&context->httpc, &currPos, NULL))) {
-                        context->bufferSize += currPos - lastPos;
+                    if(R_FAILED(posRes = httpcGetDownloadSizeState(&context->httpc, &currPos, NULL))) {
+                        res = posRes;
+                        break;
+                    }
 
-                        context->inflate.next_in = context->buffer;
-                        context->inflate.next_out = buffer + outPos;
-                        context->inflate.avail_in = context->bufferSize;
-                        context->inflate.avail_out = size - outPos;
-                        inflate(&context->inflate, Z_SYNC_FLUSH);
+                    context->bufferSize += currPos - lastPos;
+                    lastPos = currPos;
+                }
 
-                        memcpy(context->buffer, context->buffer + (context->bufferSize - context->inflate.avail_in), context->inflate.avail_in);
-                        context->bufferSize = context->inflate.avail_in;
+                context->inflate.next_in = context->buffer;
+                context->inflate.next_out = buffer + outPos;
+                context->inflate.avail_in = context->bufferSize;
+                context->inflate.avail_out = size - outPos;
+                int inflateRes = inflate(&context->inflate, Z_SYNC_FLUSH);
 
-                        lastPos = currPos;
-                        outPos = size - context->inflate.avail_out;
-                    } else {
-                        res = posRes;
-                    }
+                memmove(context->buffer, context->buffer + (context->bufferSize - context->inflate.avail_in), context->inflate.avail_in);
+                context->bufferSize = context->inflate.avail_in;
+
+                outPos = size - context->inflate.avail_out;
+
+                if(inflateRes == Z_STREAM_END) {
+                    context->inflateFinished = true;
+                } else if((inflateRes != Z_OK && inflateRes != Z_BUF_ERROR) || (inflateRes == Z_BUF_ERROR && res != HTTPC_RESULTCODE_DOWNLOADPENDING)) {
+                    // Corrupt stream, or the body ended before the stream did.
+                    res = R_APP_BAD_DATA;
+                    break;
                 }
             }
         } else {
@@ -300,15 +317,20 @@ Result http_download_callback(const char* url, u32 bufferSize, void* userData, R
 
                 u32 total = 0;
                 u32 currSize = 0;
-                while(total < dlSize
+                while(!httpc_is_finished(context, total, dlSize)
                       && (checkRunning == NULL || R_SUCCEEDED(res = checkRunning(userData)))
                       && R_SUCCEEDED(res = httpc_read(context, &currSize, buf, bufferSize))
-                      && R_SUCCEEDED(res = callback(userData, buf, currSize))) {
+                      && (currSize == 0 || R_SUCCEEDED(res = callback(userData, buf, currSize)))) {
+                    total += currSize;
+
                     if(progress != NULL) {
-                        progress(userData, dlSize, total);
-                    }
+                        u32 received = total;
+                        if(context->compressed) {
+                            httpcGetDownloadSizeState(&context->httpc, &received, NULL);
+                        }
 
-                    total += currSize;
+                        progress(userData, dlSize, received);
+                    }
                 }
 
                 Result closeRes = httpc_close(context);
@@ -378,6 +400,9 @@ typedef struct {
     size_t size;
 
     size_t pos;
+
+    void* userData;
+    Result (*checkRunning)(void* userData);
 } http_buffer_data;
 
 static Result http_download_buffer_callback(void* userData, void* buffer, size_t size) {
@@ -397,10 +422,15 @@ static Result http_download_buffer_callback(void* userData, void* buffer, size_t
     return 0;
 }
 
+static Result http_download_buffer_check_running(void* userData) {
+    http_buffer_data* data = (http_buffer_data*) userData;
 
-Result http_download_buffer(const char* url, u32* downloadedSize, void* buf, size_t size) {
-    http_buffer_data data = {buf, size, 0};
-    Result res = http_download_callback(url, size, &data, http_download_buffer_callback, NULL, NULL);
+    return data->checkRunning != NULL ? data->checkRunning(data->userData) : 0;
+}
+
+static Result http_download_buffer_internal(const char* url, u32* downloadedSize, void* buf, size_t size, void* userData, Result (*checkRunning)(void* userData)) {
+    http_buffer_data data = {buf, size, 0, userData, checkRunning};
+    Result res = http_download_callback(url, size, &data, http_download_buffer_callback, http_download_buffer_check_running, NULL);
 
     if(R_SUCCEEDED(res)) {
         *downloadedSize = data.pos;
@@ -409,7 +439,15 @@ Result http_download_buffer(const char* url, u32* downloadedSize, void* buf, siz
     return res;
 }
 
+Result http_download_buffer(const char* url, u32* downloadedSize, void* buf, size_t size) {
+    return http_download_buffer_internal(url, downloadedSize, buf, size, NULL, NULL);
+}
+
 Result http_download_json(const char* url, json_t** json, size_t maxSize) {
+    return http_download_json_check_running(url, json, maxSize, NULL, NULL);
+}
+
+Result http_download_json_check_running(const char* url, json_t** json, size_t maxSize, void* userData, Result (*checkRunning)(void* userData)) {
     if(url == NULL || json == NULL) {
         return R_APP_INVALID_ARGUMENT;
     }
@@ -419,7 +457,7 @@ Result http_download_json(const char* url, json_t** json, size_t maxSize) {
     char* text = (char*) calloc(sizeof(char), maxSize);
     if(text != NULL) {
         u32 textSize = 0;
-        if(R_SUCCEEDED(res = http_download_buffer(url, &textSize, text, maxSize))) {
+        if(R_SUCCEEDED(res = http_download_buffer_internal(url, &textSize, text, maxSize, userData, checkRunning))) {
             json_error_t error;
             json_t* parsed = json_loads(text, 0, &error);
             if(parsed != NULL) {
@@ -5,4 +5,5 @@ Result http_download_callback(const char* url, u32 bufferSize, void* userData, R
                                                                                Result (*progress)(void* userData, u64 total, u64 curr));
 Result http_download_buffer(const char* url, u32* downloadedSize, void* buf, size_t size);
 Result http_download_json(const char* url, json_t** json, size_t maxSize);
+Result http_download_json_check_running(const char* url, json_t** json, size_t maxSize, void* userData, Result (*checkRunning)(void* userData));
 Result http_download_seed(u64 titleId);
\ No newline at end of file
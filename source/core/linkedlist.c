@@ -7,6 +7,8 @@ void linked_list_init(linked_list* list) {
     list->first = NULL;
     list->last = NULL;
     list->size = 0;
+    list->version = 0;
+    list->indexVersion = 0;
 }
 
 void linked_list_destroy(linked_list* list) {
@@ -17,6 +19,14 @@ unsigned int linked_list_size(linked_list* list) {
     return list->size;
 }
 
+unsigned int linked_list_version(linked_list* list) {
+    return list->version;
+}
+
+unsigned int linked_list_index_version(linked_list* list) {
+    return list->indexVersion;
+}
+
 void linked_list_clear(linked_list* list) {
     linked_list_node* node = list->first;
     while(node != NULL) {
@@ -28,6 +38,8 @@ void linked_list_clear(linked_list* list) {
     list->first = NULL;
     list->last = NULL;
     list->size = 0;
+    list->version++;
+    list->indexVersion++;
 }
 
 bool linked_list_contains(linked_list* list, void* value) {
@@ -102,6 +114,7 @@ bool linked_list_add(linked_list* list, void* value) {
     }
 
     list->size++;
+    list->version++;
     return true;
 }
 
@@ -138,6 +151,8 @@ bool linked_list_add_at(linked_list* list, unsigned int index, void* value) {
     }
 
     list->size++;
+    list->version++;
+    list->indexVersion++;
     return true;
 }
 
@@ -177,6 +192,8 @@ static void linked_list_remove_node(linked_list* list, linked_list_node* node) {
     }
 
     list->size--;
+    list->version++;
+    list->indexVersion++;
 
     free(node);
 }
@@ -210,28 +227,148 @@ bool linked_list_remove_at(linked_list* list, unsigned int index) {
     return true;
 }
 
+// Bottom-up merge sort over the node chain: runs of width 1, 2, 4, ... are merged pairwise until one remains.
+// Ties keep their existing order.
 void linked_list_sort(linked_list* list, void* userData, int (*compare)(void* userData, const void* p1, const void* p2)) {
-    bool swapped = true;
-    while(swapped) {
-        swapped = false;
+    if(list->first == NULL || list->first == list->last) {
+        return;
+    }
+
+    linked_list_node* head = list->first;
+    linked_list_node* tail = NULL;
+
+    for(unsigned int width = 1; ; width *= 2) {
+        linked_list_node* left = head;
+        unsigned int merges = 0;
+
+        head = NULL;
+        tail = NULL;
+
+        while(left != NULL) {
+            merges++;
+
+            linked_list_node* right = left;
+            unsigned int leftSize = 0;
+            while(leftSize < width && right != NULL) {
+                leftSize++;
+                right = right->next;
+            }
+
+            unsigned int rightSize = width;
+
+            while(leftSize > 0 || (rightSize > 0 && right != NULL)) {
+                linked_list_node* node = NULL;
+                if(leftSize == 0) {
+                    node = right;
+                    right = right->next;
+                    rightSize--;
+                } else if(rightSize == 0 || right == NULL || compare(userData, left->value, right->value) <= 0) {
+                    node = left;
+                    left = left->next;
+                    leftSize--;
+                } else {
+                    node = right;
+                    right = right->next;
+                    rightSize--;
+                }
+
+                if(tail != NULL) {
+                    tail->next = node;
+                } else {
+                    head = node;
+                }
+
+                tail = node;
+            }
+
+            left = right;
+        }
+
+        tail->next = NULL;
+
+        if(merges <= 1) {
+            break;
+        }
+    }
+
+    linked_list_node* prev = NULL;
+    for(linked_list_node* node = head; node != NULL; node = node->next) {
+        node->prev = prev;
+        prev = node;
+    }
 
-        linked_list_node* curr = list->first;
-        if(curr == NULL) {
-            return;
+    list->first = head;
+    list->last = tail;
+
+    list->version++;
+    list->indexVersion++;
+}
+
+// Sorts values, then splices its nodes into the already sorted list in a single pass, leaving values empty.
+// Produces the same order as calling linked_list_add_sorted for each value in turn.
+void linked_list_merge_sorted(linked_list* list, linked_list* values, void* userData, int (*compare)(void* userData, const void* p1, const void* p2)) {
+    if(values->first == NULL) {
+        return;
+    }
+
+    if(compare != NULL) {
+        linked_list_sort(values, userData, compare);
+    }
+
+    bool inserted = false;
+
+    linked_list_node* curr = list->first;
+    linked_list_node* node = values->first;
+    while(node != NULL) {
+        linked_list_node* next = node->next;
+
+        if(compare != NULL) {
+            while(curr != NULL && compare(userData, node->value, curr->value) >= 0) {
+                curr = curr->next;
+            }
+        } else {
+            curr = NULL;
         }
 
-        linked_list_node* next = NULL;
-        while((next = curr->next) != NULL) {
-            if(compare(userData, curr->value, next->value) > 0) {
-                void* temp = curr->value;
-                curr->value = next->value;
-                next->value = temp;
+        if(curr != NULL) {
+            node->prev = curr->prev;
+            node->next = curr;
+
+            if(curr->prev != NULL) {
+                curr->prev->next = node;
+            } else {
+                list->first = node;
+            }
+
+            curr->prev = node;
+
+            inserted = true;
+        } else {
+            node->prev = list->last;
+            node->next = NULL;
 
-                swapped = true;
+            if(list->last != NULL) {
+                list->last->next = node;
+            } else {
+                list->first = node;
             }
 
-            curr = next;
+            list->last = node;
         }
+
+        list->size++;
+        node = next;
+    }
+
+    values->first = NULL;
+    values->last = NULL;
+    values->size = 0;
+    values->version++;
+    values->indexVersion++;
+
+    list->version++;
+    if(inserted) {
+        list->indexVersion++;
     }
 }
 
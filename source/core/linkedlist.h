@@ -12,6 +12,10 @@ typedef struct linked_list_s {
     linked_list_node* first;
     linked_list_node* last;
     unsigned int size;
+    // Incremented by every modification, so that views of the list can tell when to refresh.
+    unsigned int version;
+    // Incremented by modifications that may change the index of existing values, i.e. all but appending.
+    unsigned int indexVersion;
 } linked_list;
 
 typedef struct linked_list_iter_s {
@@ -24,6 +28,8 @@ void linked_list_init(linked_list* list);
 void linked_list_destroy(linked_list* list);
 
 unsigned int linked_list_size(linked_list* list);
+unsigned int linked_list_version(linked_list* list);
+unsigned int linked_list_index_version(linked_list* list);
 void linked_list_clear(linked_list* list);
 bool linked_list_contains(linked_list* list, void* value);
 int linked_list_index_of(linked_list* list, void* value);
@@ -34,6 +40,7 @@ void linked_list_add_sorted(linked_list* list, void* value, void* userData, int
 bool linked_list_remove(linked_list* list, void* value);
 bool linked_list_remove_at(linked_list* list, unsigned int index);
 void linked_list_sort(linked_list* list, void* userData, int (*compare)(void* userData, const void* p1, const void* p2));
+void linked_list_merge_sorted(linked_list* list, linked_list* values, void* userData, int (*compare)(void* userData, const void* p1, const void* p2));
 
 void linked_list_iterate(linked_list* list, linked_list_iter* iter);
 
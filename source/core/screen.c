@@ -2,6 +2,7 @@
 #include <malloc.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <3ds.h>
 #include <citro3d.h>
@@ -12,8 +13,24 @@
 
 #include "default_shbin.h"
 
+#define CMDBUF_SIZE (C3D_DEFAULT_CMDBUF_SIZE * 4)
+
+// Quads are batched into a vertex buffer as two triangles each; the buffer is refilled every frame.
+#define MAX_QUADS 4096
+#define QUAD_VERTICES 6
+
+typedef struct {
+    float x;
+    float y;
+    float z;
+    float u;
+    float v;
+} screen_vertex;
+
 static bool c3d_initialized;
 
+static void screen_clear_layouts();
+
 static bool shader_initialized;
 static DVLB_s* dvlb;
 static shaderProgram_s program;
@@ -27,18 +44,111 @@ static C3D_Tex* glyph_sheets;
 static u32 glyph_count;
 static float font_scale;
 
+// Unscaled glyph metrics, cached per code point in pages of 256. Positions from
+// fontCalcGlyphPos scale linearly, so they are stored at a scale of 1.
+typedef struct {
+    bool valid;
+    u32 sheet;
+    float charWidth;
+    float xOffset;
+    float width;
+    float top;
+    float height;
+    float xAdvance;
+    float texLeft;
+    float texBottom;
+    float texRight;
+    float texTop;
+} screen_glyph_metrics;
+
+#define GLYPH_PAGE_SIZE 256
+#define GLYPH_PAGE_COUNT (0x10000 / GLYPH_PAGE_SIZE)
+
+static screen_glyph_metrics* glyph_pages[GLYPH_PAGE_COUNT];
+
 static u8 base_alpha = 0xFF;
 
+static screen_vertex* vertices;
+static u32 vertex_count;
+static u32 batch_start;
+
+static C3D_Tex* bound_tex;
+static volatile bool textures_changed;
+
+static bool blend_valid;
+static u32 blend_color;
+static bool blend_rgb;
+static bool blend_alpha;
+
+static u32 frame_draw_calls;
+static u32 frame_quads;
+
+static u32 last_draw_calls;
+static u32 last_quads;
+static u32 last_cmdbuf_bytes;
+
 static u32 color_config[MAX_COLORS] = {0xFF000000};
 
+// Textures packed into an atlas page have no texture of their own; atlas points to the page and
+// atlasX/atlasY give the position of their image within it.
 static struct {
     bool allocated;
     C3D_Tex tex;
     u32 width;
     u32 height;
+    bool linearFilter;
+
+    C3D_Tex* atlas;
+    u32 atlasX;
+    u32 atlasY;
 } textures[MAX_TEXTURES];
 
+#define ATLAS_PAGE_SIZE 512
+#define ATLAS_MAX_PAGES 4
+#define ATLAS_GUTTER 1
+
+// Pages are packed with a skyline holding the filled height of every column.
+static struct {
+    C3D_Tex tex;
+    bool linearFilter;
+    u16 skyline[ATLAS_PAGE_SIZE];
+} atlas_pages[ATLAS_MAX_PAGES];
+
+static u32 atlas_page_count;
+
+static void screen_flush_batch() {
+    if(vertex_count > batch_start) {
+        C3D_DrawArrays(GPU_TRIANGLES, (int) batch_start, (int) (vertex_count - batch_start));
+
+        batch_start = vertex_count;
+        frame_draw_calls++;
+    }
+}
+
+static void screen_bind_texture(C3D_Tex* tex) {
+    if(tex != bound_tex || textures_changed) {
+        textures_changed = false;
+
+        screen_flush_batch();
+
+        C3D_TexBind(0, tex);
+        bound_tex = tex;
+    }
+}
+
+// Textures are also loaded from task threads, so loaders leave the batch alone and only flag that a bound
+// texture may have been replaced, once they are done with it; the next draw rebinds.
+static void screen_invalidate_textures() {
+    textures_changed = true;
+}
+
 static void screen_set_blend(u32 color, bool rgb, bool alpha) {
+    if(blend_valid && color == blend_color && rgb == blend_rgb && alpha == blend_alpha) {
+        return;
+    }
+
+    screen_flush_batch();
+
     C3D_TexEnv* env = C3D_GetTexEnv(0);
     if(env == NULL) {
         error_panic("Failed to retrieve combiner settings.");
@@ -64,10 +174,62 @@ static void screen_set_blend(u32 color, bool rgb, bool alpha) {
     }
 
     C3D_TexEnvColor(env, color);
+
+    blend_valid = true;
+    blend_color = color;
+    blend_rgb = rgb;
+    blend_alpha = alpha;
+}
+
+static void screen_calc_glyph_metrics(screen_glyph_metrics* metrics, u32 code) {
+    int glyphIndex = fontGlyphIndexFromCodePoint(NULL, code);
+
+    fontGlyphPos_s data;
+    fontCalcGlyphPos(&data, NULL, glyphIndex, GLYPH_POS_CALC_VTXCOORD, 1.0f, 1.0f);
+
+    if(data.sheetIndex >= glyph_count) {
+        fontCalcGlyphPos(&data, NULL, fontGlyphIndexFromCodePoint(NULL, 0xFFFD), GLYPH_POS_CALC_VTXCOORD, 1.0f, 1.0f);
+    }
+
+    // Line wrapping measures the requested glyph even when the replacement character is drawn.
+    metrics->valid = true;
+    metrics->sheet = (u32) data.sheetIndex;
+    metrics->charWidth = fontGetCharWidthInfo(NULL, glyphIndex)->charWidth;
+    metrics->xOffset = data.vtxcoord.left;
+    metrics->width = data.vtxcoord.right - data.vtxcoord.left;
+    metrics->top = data.vtxcoord.top;
+    metrics->height = data.vtxcoord.bottom - data.vtxcoord.top;
+    metrics->xAdvance = data.xAdvance;
+    metrics->texLeft = data.texcoord.left;
+    metrics->texBottom = data.texcoord.bottom;
+    metrics->texRight = data.texcoord.right;
+    metrics->texTop = data.texcoord.top;
+}
+
+static const screen_glyph_metrics* screen_get_glyph_metrics(u32 code) {
+    static screen_glyph_metrics uncached;
+
+    u32 page = code / GLYPH_PAGE_SIZE;
+    if(page >= GLYPH_PAGE_COUNT) {
+        screen_calc_glyph_metrics(&uncached, code);
+        return &uncached;
+    }
+
+    if(glyph_pages[page] == NULL && (glyph_pages[page] = (screen_glyph_metrics*) calloc(GLYPH_PAGE_SIZE, sizeof(screen_glyph_metrics))) == NULL) {
+        screen_calc_glyph_metrics(&uncached, code);
+        return &uncached;
+    }
+
+    screen_glyph_metrics* metrics = &glyph_pages[page][code % GLYPH_PAGE_SIZE];
+    if(!metrics->valid) {
+        screen_calc_glyph_metrics(metrics, code);
+    }
+
+    return metrics;
 }
 
 void screen_init() {
-    if(!C3D_Init(C3D_DEFAULT_CMDBUF_SIZE * 4)) {
+    if(!C3D_Init(CMDBUF_SIZE)) {
         error_panic("Failed to initialize the GPU.");
         return;
     }
@@ -127,6 +289,21 @@ void screen_init() {
     AttrInfo_AddLoader(attrInfo, 0, GPU_FLOAT, 3);
     AttrInfo_AddLoader(attrInfo, 1, GPU_FLOAT, 2);
 
+    vertices = (screen_vertex*) linearAlloc(MAX_QUADS * QUAD_VERTICES * sizeof(screen_vertex));
+    if(vertices == NULL) {
+        error_panic("Failed to allocate vertex buffer.");
+        return;
+    }
+
+    C3D_BufInfo* bufInfo = C3D_GetBufInfo();
+    if(bufInfo == NULL) {
+        error_panic("Failed to retrieve buffer info.");
+        return;
+    }
+
+    BufInfo_Init(bufInfo);
+    BufInfo_Add(bufInfo, vertices, sizeof(screen_vertex), 2, 0x10);
+
     C3D_DepthTest(true, GPU_GEQUAL, GPU_WRITE_ALL);
 
     screen_set_blend(0, false, false);
@@ -157,6 +334,11 @@ void screen_init() {
     }
 
     font_scale = 30.0f / glyphInfo->cellHeight; // 30 is cellHeight in J machines
+
+    // ASCII and Latin-1 are laid out up front; other pages are filled in as they are used.
+    for(u32 code = 0; code < GLYPH_PAGE_SIZE; code++) {
+        screen_get_glyph_metrics(code);
+    }
 }
 
 void screen_exit() {
@@ -164,6 +346,15 @@ void screen_exit() {
         screen_unload_texture(id);
     }
 
+    screen_clear_layouts();
+
+    for(u32 i = 0; i < GLYPH_PAGE_COUNT; i++) {
+        if(glyph_pages[i] != NULL) {
+            free(glyph_pages[i]);
+            glyph_pages[i] = NULL;
+        }
+    }
+
     if(glyph_sheets != NULL) {
         free(glyph_sheets);
         glyph_sheets = NULL;
@@ -179,6 +370,17 @@ void screen_exit() {
         dvlb = NULL;
     }
 
+    for(u32 i = 0; i < atlas_page_count; i++) {
+        C3D_TexDelete(&atlas_pages[i].tex);
+    }
+
+    atlas_page_count = 0;
+
+    if(vertices != NULL) {
+        linearFree(vertices);
+        vertices = NULL;
+    }
+
     if(target_top != NULL) {
         C3D_RenderTargetDelete(target_top);
         target_top = NULL;
@@ -270,6 +472,8 @@ static void screen_prepare_texture(u32* pow2WidthOut, u32* pow2HeightOut, u32 id
     textures[id].allocated = true;
     textures[id].width = width;
     textures[id].height = height;
+    textures[id].linearFilter = linearFilter;
+    textures[id].atlas = NULL;
 
     if(pow2WidthOut != NULL) {
         *pow2WidthOut = pow2Width;
@@ -300,6 +504,22 @@ void screen_load_texture_tiled(u32 id, void* data, u32 size, u32 width, u32 heig
     }
 
     C3D_TexFlush(&textures[id].tex);
+    screen_invalidate_textures();
+}
+
+// Copies a linear image into the 8x8 Morton-ordered tiles of a texture dstWidth pixels wide, at (dstX, dstY).
+static void screen_copy_to_tiles(u8* dst, u32 dstWidth, u32 dstX, u32 dstY, const u8* src, u32 width, u32 height, u32 pixelSize) {
+    for(u32 x = 0; x < width; x++) {
+        for(u32 y = 0; y < height; y++) {
+            u32 tx = dstX + x;
+            u32 ty = dstY + y;
+
+            u32 dstPos = ((((ty >> 3) * (dstWidth >> 3) + (tx >> 3)) << 6) + ((tx & 1) | ((ty & 1) << 1) | ((tx & 2) << 1) | ((ty & 2) << 2) | ((tx & 4) << 2) | ((ty & 4) << 3))) * pixelSize;
+            u32 srcPos = (y * width + x) * pixelSize;
+
+            memcpy(&dst[dstPos], &src[srcPos], pixelSize);
+        }
+    }
 }
 
 void screen_load_texture_untiled(u32 id, void* data, u32 size, u32 width, u32 height, GPU_TEXCOLOR format, bool linearFilter) {
@@ -310,16 +530,10 @@ void screen_load_texture_untiled(u32 id, void* data, u32 size, u32 width, u32 he
     u32 pixelSize = size / width / height;
 
     memset(textures[id].tex.data, 0, textures[id].tex.size);
-    for(u32 x = 0; x < width; x++) {
-        for(u32 y = 0; y < height; y++) {
-            u32 dstPos = ((((y >> 3) * (pow2Width >> 3) + (x >> 3)) << 6) + ((x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2) | ((x & 4) << 2) | ((y & 4) << 3))) * pixelSize;
-            u32 srcPos = (y * width + x) * pixelSize;
-
-            memcpy(&((u8*) textures[id].tex.data)[dstPos], &((u8*) data)[srcPos], pixelSize);
-        }
-    }
+    screen_copy_to_tiles((u8*) textures[id].tex.data, pow2Width, 0, 0, (u8*) data, width, height, pixelSize);
 
     C3D_TexFlush(&textures[id].tex);
+    screen_invalidate_textures();
 }
 
 void screen_load_texture_path(u32 id, const char* path, bool linearFilter) {
@@ -339,12 +553,8 @@ void screen_load_texture_path(u32 id, const char* path, bool linearFilter) {
     fclose(fd);
 }
 
-void screen_load_texture_file(u32 id, FILE* fd, bool linearFilter) {
-    if(id >= MAX_TEXTURES) {
-        error_panic("Attempted to load file to invalid texture ID \"%lu\".", id);
-        return;
-    }
-
+// Decodes an image file to RGBA8 with the byte order expected by the GPU.
+static u8* screen_decode_image(u32 id, FILE* fd, u32* widthOut, u32* heightOut) {
     int width;
     int height;
     int depth;
@@ -352,7 +562,7 @@ void screen_load_texture_file(u32 id, FILE* fd, bool linearFilter) {
 
     if(image == NULL) {
         error_panic("Failed to load PNG file to texture ID \"%lu\".", id);
-        return;
+        return NULL;
     }
 
     for(u32 x = 0; x < width; x++) {
@@ -371,11 +581,148 @@ void screen_load_texture_file(u32 id, FILE* fd, bool linearFilter) {
         }
     }
 
-    screen_load_texture_untiled(id, image, (u32) (width * height * 4), (u32) width, (u32) height, GPU_RGBA8, linearFilter);
+    *widthOut = (u32) width;
+    *heightOut = (u32) height;
+    return image;
+}
+
+void screen_load_texture_file(u32 id, FILE* fd, bool linearFilter) {
+    if(id >= MAX_TEXTURES) {
+        error_panic("Attempted to load file to invalid texture ID \"%lu\".", id);
+        return;
+    }
+
+    u32 width = 0;
+    u32 height = 0;
+    u8* image = screen_decode_image(id, fd, &width, &height);
+    if(image == NULL) {
+        return;
+    }
+
+    screen_load_texture_untiled(id, image, width * height * 4, width, height, GPU_RGBA8, linearFilter);
 
     free(image);
 }
 
+// Finds the lowest position a w by h rectangle fits at in an atlas page.
+static bool screen_atlas_find(u16* skyline, u32 w, u32 h, u32* xOut, u32* yOut) {
+    bool found = false;
+
+    for(u32 x = 0; x + w <= ATLAS_PAGE_SIZE; x++) {
+        u32 y = 0;
+        for(u32 i = x; i < x + w; i++) {
+            if(skyline[i] > y) {
+                y = skyline[i];
+            }
+        }
+
+        if(y + h <= ATLAS_PAGE_SIZE && (!found || y < *yOut)) {
+            found = true;
+            *xOut = x;
+            *yOut = y;
+        }
+    }
+
+    return found;
+}
+
+void screen_load_texture_file_atlas(u32 id, FILE* fd, bool linearFilter) {
+    if(id >= MAX_TEXTURES) {
+        error_panic("Attempted to load file to invalid texture ID \"%lu\".", id);
+        return;
+    }
+
+    u32 width = 0;
+    u32 height = 0;
+    u8* image = screen_decode_image(id, fd, &width, &height);
+    if(image == NULL) {
+        return;
+    }
+
+    // Large images, such as screen backgrounds, would crowd out everything else.
+    u32 w = width + ATLAS_GUTTER * 2;
+    u32 h = height + ATLAS_GUTTER * 2;
+    if(width * height > ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE / 4 || w > ATLAS_PAGE_SIZE || h > ATLAS_PAGE_SIZE) {
+        screen_load_texture_untiled(id, image, width * height * 4, width, height, GPU_RGBA8, linearFilter);
+
+        free(image);
+        return;
+    }
+
+    // The gutter repeats the image's edge texels, so filtering at its border samples the image itself rather
+    // than its neighbours or transparent black.
+    u8* padded = (u8*) malloc(w * h * 4);
+    if(padded == NULL) {
+        screen_load_texture_untiled(id, image, width * height * 4, width, height, GPU_RGBA8, linearFilter);
+
+        free(image);
+        return;
+    }
+
+    for(u32 py = 0; py < h; py++) {
+        u32 sy = py < ATLAS_GUTTER ? 0 : py - ATLAS_GUTTER < height ? py - ATLAS_GUTTER : height - 1;
+
+        for(u32 px = 0; px < w; px++) {
+            u32 sx = px < ATLAS_GUTTER ? 0 : px - ATLAS_GUTTER < width ? px - ATLAS_GUTTER : width - 1;
+
+            memcpy(&padded[(py * w + px) * 4], &image[(sy * width + sx) * 4], 4);
+        }
+    }
+
+    u32 page = 0;
+    u32 x = 0;
+    u32 y = 0;
+    while(page < atlas_page_count && (atlas_pages[page].linearFilter != linearFilter || !screen_atlas_find(atlas_pages[page].skyline, w, h, &x, &y))) {
+        page++;
+    }
+
+    if(page == atlas_page_count) {
+        if(page == ATLAS_MAX_PAGES || !C3D_TexInit(&atlas_pages[page].tex, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, GPU_RGBA8)) {
+            screen_load_texture_untiled(id, image, width * height * 4, width, height, GPU_RGBA8, linearFilter);
+
+            free(padded);
+            free(image);
+            return;
+        }
+
+        memset(atlas_pages[page].tex.data, 0, atlas_pages[page].tex.size);
+        C3D_TexSetFilter(&atlas_pages[page].tex, linearFilter ? GPU_LINEAR : GPU_NEAREST, GPU_NEAREST);
+
+        atlas_pages[page].linearFilter = linearFilter;
+        memset(atlas_pages[page].skyline, 0, sizeof(atlas_pages[page].skyline));
+
+        atlas_page_count++;
+
+        x = 0;
+        y = 0;
+    }
+
+    for(u32 i = x; i < x + w; i++) {
+        atlas_pages[page].skyline[i] = (u16) (y + h);
+    }
+
+    screen_copy_to_tiles((u8*) atlas_pages[page].tex.data, ATLAS_PAGE_SIZE, x, y, padded, w, h, 4);
+    C3D_TexFlush(&atlas_pages[page].tex);
+
+    free(padded);
+    free(image);
+
+    if(textures[id].tex.data != NULL) {
+        C3D_TexDelete(&textures[id].tex);
+        textures[id].tex.data = NULL;
+    }
+
+    textures[id].allocated = true;
+    textures[id].width = width;
+    textures[id].height = height;
+    textures[id].linearFilter = linearFilter;
+    textures[id].atlas = &atlas_pages[page].tex;
+    textures[id].atlasX = x + ATLAS_GUTTER;
+    textures[id].atlasY = y + ATLAS_GUTTER;
+
+    screen_invalidate_textures();
+}
+
 void screen_unload_texture(u32 id) {
     if(id >= MAX_TEXTURES) {
         error_panic("Attempted to unload invalid texture ID \"%lu\".", id);
@@ -384,10 +731,13 @@ void screen_unload_texture(u32 id) {
 
     C3D_TexDelete(&textures[id].tex);
     textures[id].tex.data = NULL;
+    textures[id].atlas = NULL;
 
     textures[id].allocated = false;
     textures[id].width = 0;
     textures[id].height = 0;
+
+    screen_invalidate_textures();
 }
 
 void screen_get_texture_size(u32* width, u32* height, u32 id) {
@@ -405,20 +755,258 @@ void screen_get_texture_size(u32* width, u32* height, u32 id) {
     }
 }
 
+#define TEXTURE_CACHE_STANDALONE 0xFFFFFFFF
+
+typedef struct {
+    u32 linearFilter;
+    u32 usedHeight;
+    u16 skyline[ATLAS_PAGE_SIZE];
+} screen_texture_cache_page;
+
+typedef struct {
+    u32 page;
+    u32 x;
+    u32 y;
+    u32 width;
+    u32 height;
+    u32 linearFilter;
+    u32 texWidth;
+    u32 texHeight;
+    u32 format;
+} screen_texture_cache_entry;
+
+// Tiles are stored in rows of 8 texels, so the rows in use form a prefix of the texture data.
+static u32 screen_texture_used_bytes(C3D_Tex* tex, u32 height) {
+    u32 rows = (height + 7) & ~7;
+    if(rows > tex->height) {
+        rows = tex->height;
+    }
+
+    return tex->size / tex->height * rows;
+}
+
+bool screen_write_texture_cache(FILE* fd, const u32* ids, u32 count) {
+    if(fwrite(&atlas_page_count, sizeof(atlas_page_count), 1, fd) != 1) {
+        return false;
+    }
+
+    for(u32 i = 0; i < atlas_page_count; i++) {
+        screen_texture_cache_page page;
+        page.linearFilter = atlas_pages[i].linearFilter;
+        page.usedHeight = 0;
+        memcpy(page.skyline, atlas_pages[i].skyline, sizeof(page.skyline));
+
+        for(u32 x = 0; x < ATLAS_PAGE_SIZE; x++) {
+            if(page.skyline[x] > page.usedHeight) {
+                page.usedHeight = page.skyline[x];
+            }
+        }
+
+        u32 usedBytes = screen_texture_used_bytes(&atlas_pages[i].tex, page.usedHeight);
+        if(fwrite(&page, sizeof(page), 1, fd) != 1 || fwrite(atlas_pages[i].tex.data, 1, usedBytes, fd) != usedBytes) {
+            return false;
+        }
+    }
+
+    for(u32 i = 0; i < count; i++) {
+        u32 id = ids[i];
+        if(id >= MAX_TEXTURES || !textures[id].allocated) {
+            return false;
+        }
+
+        screen_texture_cache_entry entry;
+        memset(&entry, 0, sizeof(entry));
+
+        entry.page = TEXTURE_CACHE_STANDALONE;
+        entry.width = textures[id].width;
+        entry.height = textures[id].height;
+        entry.linearFilter = textures[id].linearFilter;
+
+        if(textures[id].atlas != NULL) {
+            for(u32 page = 0; page < atlas_page_count; page++) {
+                if(textures[id].atlas == &atlas_pages[page].tex) {
+                    entry.page = page;
+                    break;
+                }
+            }
+
+            entry.x = textures[id].atlasX;
+            entry.y = textures[id].atlasY;
+
+            if(fwrite(&entry, sizeof(entry), 1, fd) != 1) {
+                return false;
+            }
+        } else {
+            entry.texWidth = textures[id].tex.width;
+            entry.texHeight = textures[id].tex.height;
+            entry.format = textures[id].tex.fmt;
+
+            u32 usedBytes = screen_texture_used_bytes(&textures[id].tex, entry.height);
+            if(fwrite(&entry, sizeof(entry), 1, fd) != 1 || fwrite(textures[id].tex.data, 1, usedBytes, fd) != usedBytes) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool screen_read_texture_cache(FILE* fd, const u32* ids, u32 count) {
+    u32 firstPage = atlas_page_count;
+
+    u32 pageCount = 0;
+    if(fread(&pageCount, sizeof(pageCount), 1, fd) != 1 || firstPage + pageCount > ATLAS_MAX_PAGES) {
+        return false;
+    }
+
+    bool success = true;
+    u32 loaded = 0;
+
+    for(u32 i = 0; i < pageCount && success; i++) {
+        screen_texture_cache_page page;
+        if(fread(&page, sizeof(page), 1, fd) != 1 || page.usedHeight > ATLAS_PAGE_SIZE) {
+            success = false;
+            break;
+        }
+
+        C3D_Tex* tex = &atlas_pages[atlas_page_count].tex;
+        if(!C3D_TexInit(tex, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, GPU_RGBA8)) {
+            success = false;
+            break;
+        }
+
+        atlas_pages[atlas_page_count].linearFilter = page.linearFilter;
+        memcpy(atlas_pages[atlas_page_count].skyline, page.skyline, sizeof(page.skyline));
+        atlas_page_count++;
+
+        u32 usedBytes = screen_texture_used_bytes(tex, page.usedHeight);
+        memset((u8*) tex->data + usedBytes, 0, tex->size - usedBytes);
+
+        if(fread(tex->data, 1, usedBytes, fd) != usedBytes) {
+            success = false;
+            break;
+        }
+
+        C3D_TexSetFilter(tex, page.linearFilter ? GPU_LINEAR : GPU_NEAREST, GPU_NEAREST);
+        C3D_TexFlush(tex);
+    }
+
+    for(; loaded < count && success; loaded++) {
+        u32 id = ids[loaded];
+
+        screen_texture_cache_entry entry;
+        if(id >= MAX_TEXTURES || fread(&entry, sizeof(entry), 1, fd) != 1) {
+            success = false;
+            break;
+        }
+
+        if(entry.page != TEXTURE_CACHE_STANDALONE) {
+            if(entry.page >= pageCount || entry.x + entry.width > ATLAS_PAGE_SIZE || entry.y + entry.height > ATLAS_PAGE_SIZE) {
+                success = false;
+                break;
+            }
+
+            if(textures[id].tex.data != NULL) {
+                C3D_TexDelete(&textures[id].tex);
+                textures[id].tex.data = NULL;
+            }
+
+            textures[id].allocated = true;
+            textures[id].width = entry.width;
+            textures[id].height = entry.height;
+            textures[id].linearFilter = entry.linearFilter;
+            textures[id].atlas = &atlas_pages[firstPage + entry.page].tex;
+            textures[id].atlasX = entry.x;
+            textures[id].atlasY = entry.y;
+        } else {
+            u32 pow2Width = 0;
+            u32 pow2Height = 0;
+            screen_prepare_texture(&pow2Width, &pow2Height, id, entry.width, entry.height, (GPU_TEXCOLOR) entry.format, entry.linearFilter);
+
+            if(pow2Width != entry.texWidth || pow2Height != entry.texHeight) {
+                loaded++;
+                success = false;
+                break;
+            }
+
+            C3D_Tex* tex = &textures[id].tex;
+
+            u32 usedBytes = screen_texture_used_bytes(tex, entry.height);
+            memset((u8*) tex->data + usedBytes, 0, tex->size - usedBytes);
+
+            if(fread(tex->data, 1, usedBytes, fd) != usedBytes) {
+                loaded++;
+                success = false;
+                break;
+            }
+
+            C3D_TexFlush(tex);
+        }
+    }
+
+    // Roll back a partial load so the caller can fall back to the source images.
+    if(!success) {
+        for(u32 i = 0; i < loaded; i++) {
+            screen_unload_texture(ids[i]);
+        }
+
+        while(atlas_page_count > firstPage) {
+            atlas_page_count--;
+
+            C3D_TexDelete(&atlas_pages[atlas_page_count].tex);
+        }
+    }
+
+    screen_invalidate_textures();
+
+    return success;
+}
+
 void screen_begin_frame() {
     if(!C3D_FrameBegin(C3D_FRAME_SYNCDRAW)) {
         error_panic("Failed to begin frame.");
         return;
     }
+
+    // The previous frame has finished drawing, so its vertices can be overwritten.
+    vertex_count = 0;
+    batch_start = 0;
+
+    frame_draw_calls = 0;
+    frame_quads = 0;
 }
 
 void screen_end_frame() {
+    screen_flush_batch();
+
+    GSPGPU_FlushDataCache(vertices, vertex_count * sizeof(screen_vertex));
+
+    last_draw_calls = frame_draw_calls;
+    last_quads = frame_quads;
+    last_cmdbuf_bytes = (u32) (C3D_GetCmdBufUsage() * CMDBUF_SIZE);
+
     C3D_FrameEnd(0);
 }
 
+void screen_get_frame_stats(u32* drawCalls, u32* quads, u32* cmdBufBytes) {
+    if(drawCalls != NULL) {
+        *drawCalls = last_draw_calls;
+    }
+
+    if(quads != NULL) {
+        *quads = last_quads;
+    }
+
+    if(cmdBufBytes != NULL) {
+        *cmdBufBytes = last_cmdbuf_bytes;
+    }
+}
+
 void screen_select(gfxScreen_t screen) {
     C3D_RenderTarget* target = screen == GFX_TOP ? target_top : target_bottom;
 
+    screen_flush_batch();
+
     C3D_RenderTargetClear(target, C3D_CLEAR_ALL, 0, 0);
     if(!C3D_FrameDrawOn(target)) {
         error_panic("Failed to select render target.");
@@ -429,21 +1017,55 @@ void screen_select(gfxScreen_t screen) {
 }
 
 static void screen_draw_quad(float x1, float y1, float x2, float y2, float left, float bottom, float right, float top) {
-    C3D_ImmDrawBegin(GPU_TRIANGLE_STRIP);
+    frame_quads++;
+
+    // Should a frame ever outgrow the vertex buffer, the remaining quads are drawn one by one.
+    if(vertex_count + QUAD_VERTICES > MAX_QUADS * QUAD_VERTICES) {
+        screen_flush_batch();
+
+        C3D_ImmDrawBegin(GPU_TRIANGLE_STRIP);
+
+        C3D_ImmSendAttrib(x1, y2, 0.5f, 0.0f);
+        C3D_ImmSendAttrib(left, bottom, 0.0f, 0.0f);
 
-    C3D_ImmSendAttrib(x1, y2, 0.5f, 0.0f);
-    C3D_ImmSendAttrib(left, bottom, 0.0f, 0.0f);
+        C3D_ImmSendAttrib(x2, y2, 0.5f, 0.0f);
+        C3D_ImmSendAttrib(right, bottom, 0.0f, 0.0f);
 
-    C3D_ImmSendAttrib(x2, y2, 0.5f, 0.0f);
-    C3D_ImmSendAttrib(right, bottom, 0.0f, 0.0f);
+        C3D_ImmSendAttrib(x1, y1, 0.5f, 0.0f);
+        C3D_ImmSendAttrib(left, top, 0.0f, 0.0f);
 
-    C3D_ImmSendAttrib(x1, y1, 0.5f, 0.0f);
-    C3D_ImmSendAttrib(left, top, 0.0f, 0.0f);
+        C3D_ImmSendAttrib(x2, y1, 0.5f, 0.0f);
+        C3D_ImmSendAttrib(right, top, 0.0f, 0.0f);
 
-    C3D_ImmSendAttrib(x2, y1, 0.5f, 0.0f);
-    C3D_ImmSendAttrib(right, top, 0.0f, 0.0f);
+        C3D_ImmDrawEnd();
 
-    C3D_ImmDrawEnd();
+        frame_draw_calls++;
+        return;
+    }
+
+    // Same corners and winding as the triangle strip (x1, y2), (x2, y2), (x1, y1), (x2, y1).
+    screen_vertex* v = &vertices[vertex_count];
+    v[0] = (screen_vertex) {x1, y2, 0.5f, left, bottom};
+    v[1] = (screen_vertex) {x2, y2, 0.5f, right, bottom};
+    v[2] = (screen_vertex) {x1, y1, 0.5f, left, top};
+    v[3] = v[2];
+    v[4] = v[1];
+    v[5] = (screen_vertex) {x2, y1, 0.5f, right, top};
+
+    vertex_count += QUAD_VERTICES;
+}
+
+// Resolves a texture ID to the texture holding its image and the image's texel position within it.
+static C3D_Tex* screen_resolve_texture(u32 id, u32* x, u32* y) {
+    if(textures[id].atlas != NULL) {
+        *x = textures[id].atlasX;
+        *y = textures[id].atlasY;
+        return textures[id].atlas;
+    }
+
+    *x = 0;
+    *y = 0;
+    return textures[id].tex.data != NULL ? &textures[id].tex : NULL;
 }
 
 void screen_draw_texture(u32 id, float x, float y, float width, float height) {
@@ -452,7 +1074,10 @@ void screen_draw_texture(u32 id, float x, float y, float width, float height) {
         return;
     }
 
-    if(textures[id].tex.data == NULL) {
+    u32 texX = 0;
+    u32 texY = 0;
+    C3D_Tex* tex = screen_resolve_texture(id, &texX, &texY);
+    if(tex == NULL) {
         return;
     }
 
@@ -460,8 +1085,8 @@ void screen_draw_texture(u32 id, float x, float y, float width, float height) {
         screen_set_blend(base_alpha << 24, false, true);
     }
 
-    C3D_TexBind(0, &textures[id].tex);
-    screen_draw_quad(x, y, x + width, y + height, 0, (float) (textures[id].tex.height - textures[id].height) / (float) textures[id].tex.height, (float) textures[id].width / (float) textures[id].tex.width, 1.0f);
+    screen_bind_texture(tex);
+    screen_draw_quad(x, y, x + width, y + height, texX / (float) tex->width, (float) (tex->height - texY - textures[id].height) / (float) tex->height, (texX + textures[id].width) / (float) tex->width, (tex->height - texY) / (float) tex->height);
 
     if(base_alpha != 0xFF) {
         screen_set_blend(0, false, false);
@@ -474,7 +1099,10 @@ void screen_draw_texture_crop(u32 id, float x, float y, float width, float heigh
         return;
     }
 
-    if(textures[id].tex.data == NULL) {
+    u32 texX = 0;
+    u32 texY = 0;
+    C3D_Tex* tex = screen_resolve_texture(id, &texX, &texY);
+    if(tex == NULL) {
         return;
     }
 
@@ -482,8 +1110,8 @@ void screen_draw_texture_crop(u32 id, float x, float y, float width, float heigh
         screen_set_blend(base_alpha << 24, false, true);
     }
 
-    C3D_TexBind(0, &textures[id].tex);
-    screen_draw_quad(x, y, x + width, y + height, 0, (float) (textures[id].tex.height - textures[id].height) / (float) textures[id].tex.height, width / (float) textures[id].tex.width, (textures[id].tex.height - textures[id].height + height) / (float) textures[id].tex.height);
+    screen_bind_texture(tex);
+    screen_draw_quad(x, y, x + width, y + height, texX / (float) tex->width, (float) (tex->height - texY - textures[id].height) / (float) tex->height, (texX + width) / (float) tex->width, (tex->height - texY - textures[id].height + height) / (float) tex->height);
 
     if(base_alpha != 0xFF) {
         screen_set_blend(0, false, false);
@@ -558,7 +1186,7 @@ static void screen_wrap_string(u32* lines, float* lineWidths, float* lineHeights
             lastAlignPos = linePos;
         }
 
-        charWidth *= scaleX * fontGetCharWidthInfo(NULL, fontGlyphIndexFromCodePoint(NULL, code))->charWidth;
+        charWidth *= scaleX * screen_get_glyph_metrics(code)->charWidth;
 
         if(code == '\n' || (wordWrap && lw + charWidth >= maxWidth)) {
             if(code == '\n') {
@@ -625,59 +1253,119 @@ static void screen_wrap_string(u32* lines, float* lineWidths, float* lineHeights
     }
 }
 
-void screen_get_string_size(float* width, float* height, const char* text, float scaleX, float scaleY) {
-    screen_wrap_string(NULL, NULL, NULL, NULL, width, height, text, 0, 0, scaleX, scaleY, false);
-}
+// Each glyph quad is stored relative to the text origin and the start of its line.
+typedef struct {
+    u32 sheet;
+    u32 line;
+    float left;
+    float top;
+    float right;
+    float bottom;
+    float texLeft;
+    float texBottom;
+    float texRight;
+    float texTop;
+} screen_glyph;
+
+typedef struct {
+    char* text;
+    u32 textCapacity;
+    u32 hash;
+    float scaleX;
+    float scaleY;
+    bool wrap;
+    float maxWidth;
+
+    u32 lastUsed;
+
+    u32 numLines;
+    float lineWidths[MAX_LINES];
+    float totalWidth;
+    float totalHeight;
 
-void screen_get_string_size_wrap(float* width, float* height, const char* text, float scaleX, float scaleY, float wrapWidth) {
-    screen_wrap_string(NULL, NULL, NULL, NULL, width, height, text, 0, wrapWidth, scaleX, scaleY, true);
-}
+    screen_glyph* glyphs;
+    u32 glyphCount;
+    u32 glyphCapacity;
+} screen_layout;
 
-static void screen_draw_string_internal(const char* text, float x, float y, float scaleX, float scaleY, u32 colorId, bool centerLines, bool wrap, float wrapX) {
-    if(text == NULL) {
-        return;
+#define LAYOUT_CACHE_SIZE 32
+
+static screen_layout layout_cache[LAYOUT_CACHE_SIZE];
+static u32 layout_clock;
+
+static void screen_clear_layouts() {
+    for(u32 i = 0; i < LAYOUT_CACHE_SIZE; i++) {
+        free(layout_cache[i].text);
+        free(layout_cache[i].glyphs);
     }
 
-    if(colorId >= MAX_COLORS) {
-        error_panic("Attempted to draw string with invalid color ID \"%lu\".", colorId);
-        return;
+    memset(layout_cache, 0, sizeof(layout_cache));
+    layout_clock = 0;
+}
+
+static void screen_layout_add_glyph(screen_layout* layout, u32 line, float x, float y, const screen_glyph_metrics* metrics, float scaleX, float scaleY) {
+    if(layout->glyphCount == layout->glyphCapacity) {
+        u32 capacity = layout->glyphCapacity > 0 ? layout->glyphCapacity * 2 : 64;
+
+        screen_glyph* glyphs = (screen_glyph*) realloc(layout->glyphs, capacity * sizeof(screen_glyph));
+        if(glyphs == NULL) {
+            error_panic("Failed to allocate text layout glyphs.");
+            return;
+        }
+
+        layout->glyphs = glyphs;
+        layout->glyphCapacity = capacity;
     }
 
-    u32 blendColor = color_config[colorId];
-    if(base_alpha != 0xFF) {
-        float alpha1 = ((blendColor >> 24) & 0xFF) / 255.0f;
-        float alpha2 = base_alpha / 255.0f;
-        float blendedAlpha = alpha1 * alpha2;
+    screen_glyph* glyph = &layout->glyphs[layout->glyphCount++];
+    glyph->sheet = metrics->sheet;
+    glyph->line = line;
+    glyph->left = x + scaleX * metrics->xOffset;
+    glyph->top = y + scaleY * metrics->top;
+    glyph->right = glyph->left + scaleX * metrics->width;
+    glyph->bottom = glyph->top + scaleY * metrics->height;
+    glyph->texLeft = metrics->texLeft;
+    glyph->texBottom = metrics->texBottom;
+    glyph->texRight = metrics->texRight;
+    glyph->texTop = metrics->texTop;
+}
 
-        blendColor = (((u32) (blendedAlpha * 0xFF)) << 24) | (blendColor & 0x00FFFFFF);
+static void screen_layout_string(screen_layout* layout, const char* text, u32 len, u32 hash, float scaleX, float scaleY, bool wrap, float maxWidth) {
+    if(len + 1 > layout->textCapacity) {
+        char* copy = (char*) realloc(layout->text, len + 1);
+        if(copy == NULL) {
+            error_panic("Failed to allocate text layout.");
+            return;
+        }
+
+        layout->text = copy;
+        layout->textCapacity = len + 1;
     }
 
-    screen_set_blend(blendColor, true, true);
+    memcpy(layout->text, text, len + 1);
+    layout->hash = hash;
+    layout->scaleX = scaleX;
+    layout->scaleY = scaleY;
+    layout->wrap = wrap;
+    layout->maxWidth = maxWidth;
 
     u32 lines[MAX_LINES];
-    float lineWidths[MAX_LINES];
     float lineHeights[MAX_LINES];
-    u32 numLines = 0;
-    float totalWidth = 0;
-    float totalHeight = 0;
-    screen_wrap_string(lines, lineWidths, lineHeights, &numLines, &totalWidth, &totalHeight, text, MAX_LINES, wrapX - x, scaleX, scaleY, wrap);
+    screen_wrap_string(lines, layout->lineWidths, lineHeights, &layout->numLines, &layout->totalWidth, &layout->totalHeight, text, MAX_LINES, maxWidth, scaleX, scaleY, wrap);
 
-    float currX = x;
-    float currY = y;
+    layout->glyphCount = 0;
+
+    float currY = 0;
 
     u32 linePos = 0;
     u32 lastAlignPos = 0;
-    int lastSheet = -1;
 
     const uint8_t* p = (const uint8_t*) text;
     u32 code = 0;
     ssize_t units = -1;
 
-    for(u32 i = 0; i < numLines; i++) {
-        currX = x;
-        if(centerLines) {
-            currX += (totalWidth - lineWidths[i]) / 2;
-        }
+    for(u32 i = 0; i < layout->numLines; i++) {
+        float currX = 0;
 
         while(linePos < lines[i] && *p && (units = decode_utf8(&code, p)) != -1 && code > 0) {
             p += units;
@@ -691,22 +1379,12 @@ static void screen_draw_string_internal(const char* text, float x, float y, floa
                     lastAlignPos = linePos;
                 }
 
-                fontGlyphPos_s data;
-                fontCalcGlyphPos(&data, NULL, fontGlyphIndexFromCodePoint(NULL, code), GLYPH_POS_CALC_VTXCOORD, scaleX * font_scale, scaleY * font_scale);
-
-                if(data.sheetIndex >= glyph_count) {
-                    fontCalcGlyphPos(&data, NULL, fontGlyphIndexFromCodePoint(NULL, 0xFFFD), GLYPH_POS_CALC_VTXCOORD, scaleX * font_scale, scaleY * font_scale);
-                }
-
-                if(data.sheetIndex < glyph_count && data.sheetIndex != lastSheet) {
-                    lastSheet = data.sheetIndex;
-                    C3D_TexBind(0, &glyph_sheets[lastSheet]);
-                }
+                const screen_glyph_metrics* metrics = screen_get_glyph_metrics(code);
 
                 for(u32 j = 0; j < num; j++) {
-                    screen_draw_quad(currX + data.vtxcoord.left, currY + data.vtxcoord.top, currX + data.vtxcoord.right, currY + data.vtxcoord.bottom, data.texcoord.left, data.texcoord.bottom, data.texcoord.right, data.texcoord.top);
+                    screen_layout_add_glyph(layout, i, currX, currY, metrics, scaleX * font_scale, scaleY * font_scale);
 
-                    currX += data.xAdvance;
+                    currX += scaleX * font_scale * metrics->xAdvance;
                 }
             }
 
@@ -718,6 +1396,103 @@ static void screen_draw_string_internal(const char* text, float x, float y, floa
         linePos = 0;
         lastAlignPos = 0;
     }
+}
+
+// Returns the cached layout of the text, laying it out over the least recently used entry on a miss.
+static screen_layout* screen_get_layout(const char* text, float scaleX, float scaleY, bool wrap, float maxWidth) {
+    if(!wrap) {
+        maxWidth = 0;
+    }
+
+    // FNV-1a
+    u32 hash = 2166136261U;
+    u32 len = 0;
+    for(const char* c = text; *c; c++, len++) {
+        hash = (hash ^ (u8) *c) * 16777619U;
+    }
+
+    screen_layout* victim = &layout_cache[0];
+    for(u32 i = 0; i < LAYOUT_CACHE_SIZE; i++) {
+        screen_layout* layout = &layout_cache[i];
+
+        if(layout->text != NULL && layout->hash == hash && layout->scaleX == scaleX && layout->scaleY == scaleY
+           && layout->wrap == wrap && layout->maxWidth == maxWidth && strcmp(layout->text, text) == 0) {
+            layout->lastUsed = ++layout_clock;
+            return layout;
+        }
+
+        if(layout->lastUsed < victim->lastUsed) {
+            victim = layout;
+        }
+    }
+
+    screen_layout_string(victim, text, len, hash, scaleX, scaleY, wrap, maxWidth);
+    victim->lastUsed = ++layout_clock;
+
+    return victim;
+}
+
+void screen_get_string_size(float* width, float* height, const char* text, float scaleX, float scaleY) {
+    screen_layout* layout = screen_get_layout(text, scaleX, scaleY, false, 0);
+
+    if(width != NULL) {
+        *width = layout->totalWidth;
+    }
+
+    if(height != NULL) {
+        *height = layout->totalHeight;
+    }
+}
+
+void screen_get_string_size_wrap(float* width, float* height, const char* text, float scaleX, float scaleY, float wrapWidth) {
+    screen_layout* layout = screen_get_layout(text, scaleX, scaleY, true, wrapWidth);
+
+    if(width != NULL) {
+        *width = layout->totalWidth;
+    }
+
+    if(height != NULL) {
+        *height = layout->totalHeight;
+    }
+}
+
+static void screen_draw_string_internal(const char* text, float x, float y, float scaleX, float scaleY, u32 colorId, bool centerLines, bool wrap, float wrapX) {
+    if(text == NULL) {
+        return;
+    }
+
+    if(colorId >= MAX_COLORS) {
+        error_panic("Attempted to draw string with invalid color ID \"%lu\".", colorId);
+        return;
+    }
+
+    u32 blendColor = color_config[colorId];
+    if(base_alpha != 0xFF) {
+        float alpha1 = ((blendColor >> 24) & 0xFF) / 255.0f;
+        float alpha2 = base_alpha / 255.0f;
+        float blendedAlpha = alpha1 * alpha2;
+
+        blendColor = (((u32) (blendedAlpha * 0xFF)) << 24) | (blendColor & 0x00FFFFFF);
+    }
+
+    screen_set_blend(blendColor, true, true);
+
+    screen_layout* layout = screen_get_layout(text, scaleX, scaleY, wrap, wrapX - x);
+
+    for(u32 i = 0; i < layout->glyphCount; i++) {
+        screen_glyph* glyph = &layout->glyphs[i];
+
+        if(glyph->sheet < glyph_count) {
+            screen_bind_texture(&glyph_sheets[glyph->sheet]);
+        }
+
+        float lineX = x;
+        if(centerLines) {
+            lineX += (layout->totalWidth - layout->lineWidths[glyph->line]) / 2;
+        }
+
+        screen_draw_quad(lineX + glyph->left, y + glyph->top, lineX + glyph->right, y + glyph->bottom, glyph->texLeft, glyph->texBottom, glyph->texRight, glyph->texTop);
+    }
 
     screen_set_blend(0, false, false);
 }
@@ -21,11 +21,18 @@ u32 screen_allocate_free_texture();
 void screen_load_texture_untiled(u32 id, void* data, u32 size, u32 width, u32 height, GPU_TEXCOLOR format, bool linearFilter);
 void screen_load_texture_path(u32 id, const char* path, bool linearFilter);
 void screen_load_texture_file(u32 id, FILE* fd, bool linearFilter);
+// Like screen_load_texture_file, but packs the image into a shared atlas page when it is small enough.
+void screen_load_texture_file_atlas(u32 id, FILE* fd, bool linearFilter);
 void screen_load_texture_tiled(u32 id, void* data, u32 size, u32 width, u32 height, GPU_TEXCOLOR format, bool linearFilter);
 void screen_unload_texture(u32 id);
 void screen_get_texture_size(u32* width, u32* height, u32 id);
+// Saves or restores the given textures, and every atlas page, as GPU-ready tiled data.
+bool screen_write_texture_cache(FILE* fd, const u32* ids, u32 count);
+bool screen_read_texture_cache(FILE* fd, const u32* ids, u32 count);
 void screen_begin_frame();
 void screen_end_frame();
+// Draw calls, quads and command buffer bytes used by the last completed frame.
+void screen_get_frame_stats(u32* drawCalls, u32* quads, u32* cmdBufBytes);
 void screen_select(gfxScreen_t screen);
 void screen_draw_texture(u32 id, float x, float y, float width, float height);
 void screen_draw_texture_crop(u32 id, float x, float y, float width, float height);
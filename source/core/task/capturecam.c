@@ -13,6 +13,18 @@
 
 #define EVENT_COUNT 3
 
+// Picks a slot to receive into after current, which becomes the newest frame, or -1 if readers hold all others.
+static s32 task_capture_cam_next_slot(capture_cam_data* data, s32 current) {
+    for(s32 i = 1; i < CAPTURE_CAM_BUFFER_COUNT; i++) {
+        s32 slot = (current + i) % CAPTURE_CAM_BUFFER_COUNT;
+        if(data->readers[slot] == 0) {
+            return slot;
+        }
+    }
+
+    return -1;
+}
+
 static void task_capture_cam_thread(void* arg) {
     capture_cam_data* data = (capture_cam_data*) arg;
 
@@ -21,85 +33,99 @@ static void task_capture_cam_thread(void* arg) {
 
     Result res = 0;
 
-    u32 bufferSize = data->width * data->height * sizeof(u16);
-    u16* buffer = (u16*) calloc(1, bufferSize);
-    if(buffer != NULL) {
-        if(R_SUCCEEDED(res = camInit())) {
-            u32 cam = data->camera == CAMERA_OUTER ? SELECT_OUT1 : SELECT_IN1;
-
-            if(R_SUCCEEDED(res = CAMU_SetSize(cam, SIZE_CTR_TOP_LCD, CONTEXT_A))
-               && R_SUCCEEDED(res = CAMU_SetOutputFormat(cam, OUTPUT_RGB_565, CONTEXT_A))
-               && R_SUCCEEDED(res = CAMU_SetFrameRate(cam, FRAME_RATE_30))
-               && R_SUCCEEDED(res = CAMU_SetNoiseFilter(cam, true))
-               && R_SUCCEEDED(res = CAMU_SetAutoExposure(cam, true))
-               && R_SUCCEEDED(res = CAMU_SetAutoWhiteBalance(cam, true))
-               && R_SUCCEEDED(res = CAMU_Activate(cam))) {
-                u32 transferUnit = 0;
-
-                if(R_SUCCEEDED(res = CAMU_GetBufferErrorInterruptEvent(&events[EVENT_BUFFER_ERROR], PORT_CAM1))
-                   && R_SUCCEEDED(res = CAMU_SetTrimming(PORT_CAM1, true))
-                   && R_SUCCEEDED(res = CAMU_SetTrimmingParamsCenter(PORT_CAM1, data->width, data->height, 400, 240))
-                   && R_SUCCEEDED(res = CAMU_GetMaxBytes(&transferUnit, data->width, data->height))
-                   && R_SUCCEEDED(res = CAMU_SetTransferBytes(PORT_CAM1, transferUnit, data->width, data->height))
-                   && R_SUCCEEDED(res = CAMU_ClearBuffer(PORT_CAM1))
-                   && R_SUCCEEDED(res = CAMU_SetReceiving(&events[EVENT_RECV], buffer, PORT_CAM1, bufferSize, (s16) transferUnit))
-                   && R_SUCCEEDED(res = CAMU_StartCapture(PORT_CAM1))) {
-                    bool cancelRequested = false;
-                    while(!task_is_quit_all() && !cancelRequested && R_SUCCEEDED(res)) {
-                        svcWaitSynchronization(task_get_pause_event(), U64_MAX);
-
-                        s32 index = 0;
-                        if(R_SUCCEEDED(res = svcWaitSynchronizationN(&index, events, EVENT_COUNT, false, U64_MAX))) {
-                            switch(index) {
-                                case EVENT_CANCEL:
-                                    cancelRequested = true;
-                                    break;
-                                case EVENT_RECV:
-                                    svcCloseHandle(events[EVENT_RECV]);
-                                    events[EVENT_RECV] = 0;
-
-                                    svcWaitSynchronization(data->mutex, U64_MAX);
-                                    memcpy(data->buffer, buffer, bufferSize);
-                                    GSPGPU_FlushDataCache(data->buffer, bufferSize);
-                                    svcReleaseMutex(data->mutex);
-
-                                    res = CAMU_SetReceiving(&events[EVENT_RECV], buffer, PORT_CAM1, bufferSize, (s16) transferUnit);
-                                    break;
-                                case EVENT_BUFFER_ERROR:
-                                    svcCloseHandle(events[EVENT_RECV]);
-                                    events[EVENT_RECV] = 0;
-
-                                    if(R_SUCCEEDED(res = CAMU_ClearBuffer(PORT_CAM1))
-                                       && R_SUCCEEDED(res = CAMU_SetReceiving(&events[EVENT_RECV], buffer, PORT_CAM1, bufferSize, (s16) transferUnit))) {
-                                        res = CAMU_StartCapture(PORT_CAM1);
-                                    }
-
-                                    break;
-                                default:
-                                    break;
-                            }
+    u32 frameSize = (u32) (data->width * data->height);
+    u32 bufferSize = frameSize * sizeof(u16);
+
+    s32 slot = 0;
+    u16* buffer = data->buffer;
+
+    if(R_SUCCEEDED(res = camInit())) {
+        u32 cam = data->camera == CAMERA_OUTER ? SELECT_OUT1 : SELECT_IN1;
+
+        if(R_SUCCEEDED(res = CAMU_SetSize(cam, SIZE_CTR_TOP_LCD, CONTEXT_A))
+           && R_SUCCEEDED(res = CAMU_SetOutputFormat(cam, OUTPUT_RGB_565, CONTEXT_A))
+           && R_SUCCEEDED(res = CAMU_SetFrameRate(cam, FRAME_RATE_30))
+           && R_SUCCEEDED(res = CAMU_SetNoiseFilter(cam, true))
+           && R_SUCCEEDED(res = CAMU_SetAutoExposure(cam, true))
+           && R_SUCCEEDED(res = CAMU_SetAutoWhiteBalance(cam, true))
+           && R_SUCCEEDED(res = CAMU_Activate(cam))) {
+            u32 transferUnit = 0;
+
+            if(R_SUCCEEDED(res = CAMU_GetBufferErrorInterruptEvent(&events[EVENT_BUFFER_ERROR], PORT_CAM1))
+               && R_SUCCEEDED(res = CAMU_SetTrimming(PORT_CAM1, true))
+               && R_SUCCEEDED(res = CAMU_SetTrimmingParamsCenter(PORT_CAM1, data->width, data->height, 400, 240))
+               && R_SUCCEEDED(res = CAMU_GetMaxBytes(&transferUnit, data->width, data->height))
+               && R_SUCCEEDED(res = CAMU_SetTransferBytes(PORT_CAM1, transferUnit, data->width, data->height))
+               && R_SUCCEEDED(res = CAMU_ClearBuffer(PORT_CAM1))
+               && R_SUCCEEDED(res = CAMU_SetReceiving(&events[EVENT_RECV], buffer, PORT_CAM1, bufferSize, (s16) transferUnit))
+               && R_SUCCEEDED(res = CAMU_StartCapture(PORT_CAM1))) {
+                bool cancelRequested = false;
+                while(!task_is_quit_all() && !cancelRequested && R_SUCCEEDED(res)) {
+                    svcWaitSynchronization(task_get_pause_event(), U64_MAX);
+
+                    s32 index = 0;
+                    if(R_SUCCEEDED(res = svcWaitSynchronizationN(&index, events, EVENT_COUNT, false, U64_MAX))) {
+                        switch(index) {
+                            case EVENT_CANCEL:
+                                cancelRequested = true;
+                                break;
+                            case EVENT_RECV:
+                                svcCloseHandle(events[EVENT_RECV]);
+                                events[EVENT_RECV] = 0;
+
+                                GSPGPU_InvalidateDataCache(buffer, bufferSize);
+
+                                // Publish the received slot and move on to a free one. With every slot
+                                // in use, the newest frame is kept and the next one dropped.
+                                svcWaitSynchronization(data->mutex, U64_MAX);
+
+                                s32 next = task_capture_cam_next_slot(data, slot);
+                                if(next >= 0) {
+                                    data->latest = slot;
+                                    data->frameCount++;
+
+                                    slot = next;
+                                    buffer = &data->buffer[slot * frameSize];
+                                }
+
+                                svcReleaseMutex(data->mutex);
+
+                                if(next >= 0) {
+                                    svcSignalEvent(data->frameEvent);
+                                }
+
+                                res = CAMU_SetReceiving(&events[EVENT_RECV], buffer, PORT_CAM1, bufferSize, (s16) transferUnit);
+                                break;
+                            case EVENT_BUFFER_ERROR:
+                                svcCloseHandle(events[EVENT_RECV]);
+                                events[EVENT_RECV] = 0;
+
+                                if(R_SUCCEEDED(res = CAMU_ClearBuffer(PORT_CAM1))
+                                   && R_SUCCEEDED(res = CAMU_SetReceiving(&events[EVENT_RECV], buffer, PORT_CAM1, bufferSize, (s16) transferUnit))) {
+                                    res = CAMU_StartCapture(PORT_CAM1);
+                                }
+
+                                break;
+                            default:
+                                break;
                         }
                     }
+                }
 
-                    CAMU_StopCapture(PORT_CAM1);
-
-                    bool busy = false;
-                    while(R_SUCCEEDED(CAMU_IsBusy(&busy, PORT_CAM1)) && busy) {
-                        svcSleepThread(1000000);
-                    }
+                CAMU_StopCapture(PORT_CAM1);
 
-                    CAMU_ClearBuffer(PORT_CAM1);
+                bool busy = false;
+                while(R_SUCCEEDED(CAMU_IsBusy(&busy, PORT_CAM1)) && busy) {
+                    svcSleepThread(1000000);
                 }
 
-                CAMU_Activate(SELECT_NONE);
+                CAMU_ClearBuffer(PORT_CAM1);
             }
 
-            camExit();
+            CAMU_Activate(SELECT_NONE);
         }
 
-        free(buffer);
-    } else {
-        res = R_APP_OUT_OF_MEMORY;
+        camExit();
     }
 
     for(int i = 0; i < EVENT_COUNT; i++) {
@@ -109,18 +135,73 @@ static void task_capture_cam_thread(void* arg) {
         }
     }
 
-    svcCloseHandle(data->mutex);
-
     data->result = res;
     data->finished = true;
 }
 
+void task_capture_cam_close(capture_cam_data* data) {
+    if(data == NULL || !data->finished) {
+        return;
+    }
+
+    if(data->mutex != 0) {
+        svcCloseHandle(data->mutex);
+        data->mutex = 0;
+    }
+
+    if(data->frameEvent != 0) {
+        svcCloseHandle(data->frameEvent);
+        data->frameEvent = 0;
+    }
+
+    data->latest = -1;
+}
+
+const u16* task_capture_cam_acquire(capture_cam_data* data, u32* frameCount) {
+    if(data == NULL || R_FAILED(svcWaitSynchronization(data->mutex, U64_MAX))) {
+        return NULL;
+    }
+
+    const u16* frame = NULL;
+
+    if(data->latest >= 0) {
+        data->readers[data->latest]++;
+        frame = &data->buffer[data->latest * data->width * data->height];
+
+        if(frameCount != NULL) {
+            *frameCount = data->frameCount;
+        }
+    }
+
+    svcReleaseMutex(data->mutex);
+
+    return frame;
+}
+
+void task_capture_cam_release(capture_cam_data* data, const u16* frame) {
+    if(data == NULL || frame == NULL || R_FAILED(svcWaitSynchronization(data->mutex, U64_MAX))) {
+        return;
+    }
+
+    u32 slot = (u32) (frame - data->buffer) / (u32) (data->width * data->height);
+    if(slot < CAPTURE_CAM_BUFFER_COUNT && data->readers[slot] > 0) {
+        data->readers[slot]--;
+    }
+
+    svcReleaseMutex(data->mutex);
+}
+
 Result task_capture_cam(capture_cam_data* data) {
     if(data == NULL || data->buffer == NULL || data->width <= 0 || data->width > 640 || data->height <= 0 || data->height > 480) {
         return R_APP_INVALID_ARGUMENT;
     }
 
     data->mutex = 0;
+    data->latest = -1;
+    memset(data->readers, 0, sizeof(data->readers));
+
+    data->frameCount = 0;
+    data->frameEvent = 0;
 
     data->finished = false;
     data->result = 0;
@@ -128,7 +209,9 @@ Result task_capture_cam(capture_cam_data* data) {
 
     Result res = 0;
 
-    if(R_SUCCEEDED(res = svcCreateEvent(&data->cancelEvent, RESET_STICKY)) && R_SUCCEEDED(res = svcCreateMutex(&data->mutex, false))) {
+    if(R_SUCCEEDED(res = svcCreateEvent(&data->cancelEvent, RESET_STICKY))
+       && R_SUCCEEDED(res = svcCreateMutex(&data->mutex, false))
+       && R_SUCCEEDED(res = svcCreateEvent(&data->frameEvent, RESET_ONESHOT))) {
         if(threadCreate(task_capture_cam_thread, data, 0x10000, 0x1A, 0, true) == NULL) {
             res = R_APP_THREAD_CREATE_FAILED;
         }
@@ -146,6 +229,11 @@ Result task_capture_cam(capture_cam_data* data) {
             svcCloseHandle(data->mutex);
             data->mutex = 0;
         }
+
+        if(data->frameEvent != 0) {
+            svcCloseHandle(data->frameEvent);
+            data->frameEvent = 0;
+        }
     }
 
     return res;
@@ -5,17 +5,36 @@ typedef enum capture_cam_camera_e {
     CAMERA_INNER
 } capture_cam_camera;
 
+// Frames are received into a rotating slot and handed to readers by index, so they are never copied.
+// Four slots leave one free for the next frame while the newest frame and one frame for each of
+// two readers (the preview and the QR scanner) are held.
+#define CAPTURE_CAM_BUFFER_COUNT 4
+
 typedef struct capture_cam_data_s {
+    // Storage for CAPTURE_CAM_BUFFER_COUNT frames of width * height pixels.
     u16* buffer;
     s16 width;
     s16 height;
     capture_cam_camera camera;
 
+    // Guards the slot state below; only held while indices are updated.
     Handle mutex;
+    s32 latest;
+    u32 readers[CAPTURE_CAM_BUFFER_COUNT];
+
+    // Incremented under mutex for every received frame; frameEvent is signaled afterwards.
+    volatile u32 frameCount;
+    Handle frameEvent;
 
     volatile bool finished;
     Result result;
     Handle cancelEvent;
 } capture_cam_data;
 
-Result task_capture_cam(capture_cam_data* data);
\ No newline at end of file
+// Starts capturing. mutex and frameEvent outlive the task, as readers may still be waiting on them when it
+// finishes; once the task has finished and every reader has stopped, task_capture_cam_close releases them.
+Result task_capture_cam(capture_cam_data* data);
+void task_capture_cam_close(capture_cam_data* data);
+// Returns the newest frame, or NULL if none is available. The frame is not overwritten until released.
+const u16* task_capture_cam_acquire(capture_cam_data* data, u32* frameCount);
+void task_capture_cam_release(capture_cam_data* data, const u16* frame);
\ No newline at end of file
@@ -245,6 +245,9 @@ static void task_data_op_thread(void* arg) {
     data_op_data* data = (data_op_data*) arg;
 
     for(data->processed = 0; data->processed < data->total; data->processed++) {
+        // Views draw the item being processed on the top screen.
+        ui_invalidate();
+
         Result res = 0;
 
         if(R_SUCCEEDED(res = task_data_op_check_running(data))) {
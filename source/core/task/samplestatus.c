@@ -0,0 +1,149 @@
+#include <string.h>
+
+#include <3ds.h>
+
+#include "samplestatus.h"
+#include "task.h"
+#include "../error.h"
+
+#define STATUS_INTERVAL_NS 500000000ULL
+#define FREE_SPACE_INTERVAL 4
+
+static const FS_SystemMediaType sample_status_media[SAMPLE_STATUS_MEDIA_COUNT] = {
+        SYSTEM_MEDIATYPE_SD,
+        SYSTEM_MEDIATYPE_CTR_NAND,
+        SYSTEM_MEDIATYPE_TWL_NAND,
+        SYSTEM_MEDIATYPE_TWL_PHOTO
+};
+
+static void task_sample_status_battery(sample_status_snapshot* snapshot) {
+    u8 batteryChargeState = 0;
+    u8 batteryLevel = 0;
+
+    snapshot->batteryCharging = R_SUCCEEDED(PTMU_GetBatteryChargeState(&batteryChargeState)) && batteryChargeState;
+    snapshot->batteryLevel = !snapshot->batteryCharging && R_SUCCEEDED(PTMU_GetBatteryLevel(&batteryLevel)) ? batteryLevel : 0;
+}
+
+static void task_sample_status_wifi(sample_status_snapshot* snapshot) {
+    u32 wifiStatus = 0;
+
+    snapshot->wifiConnected = R_SUCCEEDED(ACU_GetWifiStatus(&wifiStatus)) && wifiStatus;
+    snapshot->wifiStrength = snapshot->wifiConnected ? osGetWifiStrength() : 0;
+}
+
+static void task_sample_status_free_space(sample_status_snapshot* snapshot) {
+    for(u32 i = 0; i < SAMPLE_STATUS_MEDIA_COUNT; i++) {
+        FS_ArchiveResource resource = {0};
+
+        snapshot->freeSpaceValid[i] = R_SUCCEEDED(FSUSER_GetArchiveResource(&resource, sample_status_media[i]));
+        snapshot->freeSpace[i] = snapshot->freeSpaceValid[i] ? (u64) resource.freeClusters * (u64) resource.clusterSize : 0;
+    }
+}
+
+// Readers never wait on the sampler; they retry or skip a copy that raced with an update.
+static void task_sample_status_publish(sample_status_data* data, const sample_status_snapshot* snapshot) {
+    if(memcmp(&data->snapshot, snapshot, sizeof(sample_status_snapshot)) == 0) {
+        return;
+    }
+
+    data->sequence++;
+    __sync_synchronize();
+
+    memcpy(&data->snapshot, snapshot, sizeof(sample_status_snapshot));
+
+    __sync_synchronize();
+    data->sequence++;
+}
+
+static void task_sample_status_thread(void* arg) {
+    sample_status_data* data = (sample_status_data*) arg;
+
+    // Snapshots are compared with memcmp, so the padding is copied byte for byte along with the fields; the
+    // published snapshot was built from a zeroed one.
+    sample_status_snapshot snapshot;
+    memcpy(&snapshot, &data->snapshot, sizeof(snapshot));
+
+    u32 ticks = 0;
+    while(!task_is_quit_all() && svcWaitSynchronization(data->cancelEvent, STATUS_INTERVAL_NS) != 0) {
+        svcWaitSynchronization(task_get_pause_event(), U64_MAX);
+
+        task_sample_status_battery(&snapshot);
+        task_sample_status_wifi(&snapshot);
+
+        if(++ticks % FREE_SPACE_INTERVAL == 0) {
+            task_sample_status_free_space(&snapshot);
+        }
+
+        task_sample_status_publish(data, &snapshot);
+    }
+
+    svcCloseHandle(data->cancelEvent);
+    data->cancelEvent = 0;
+
+    data->finished = true;
+}
+
+bool task_sample_status_read(sample_status_data* data, sample_status_snapshot* snapshot, u32* sequence) {
+    for(u32 attempt = 0; attempt < 4; attempt++) {
+        u32 start = data->sequence;
+        if(start == *sequence || (start & 1) != 0) {
+            return false;
+        }
+
+        __sync_synchronize();
+
+        memcpy(snapshot, &data->snapshot, sizeof(sample_status_snapshot));
+
+        __sync_synchronize();
+
+        if(data->sequence == start) {
+            *sequence = start;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+Result task_sample_status(sample_status_data* data) {
+    if(data == NULL) {
+        return R_APP_INVALID_ARGUMENT;
+    }
+
+    data->sequence = 0;
+    memset(&data->snapshot, 0, sizeof(data->snapshot));
+
+    data->finished = false;
+    data->result = 0;
+    data->cancelEvent = 0;
+
+    // Take the first sample up front so the status bar is filled in from the first frame.
+    sample_status_snapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+
+    task_sample_status_battery(&snapshot);
+    task_sample_status_wifi(&snapshot);
+    task_sample_status_free_space(&snapshot);
+
+    memcpy(&data->snapshot, &snapshot, sizeof(snapshot));
+    data->sequence = 2;
+
+    Result res = 0;
+
+    if(R_SUCCEEDED(res = svcCreateEvent(&data->cancelEvent, RESET_STICKY))) {
+        if(threadCreate(task_sample_status_thread, data, 0x4000, 0x3F, 1, true) == NULL) {
+            res = R_APP_THREAD_CREATE_FAILED;
+        }
+    }
+
+    if(R_FAILED(res)) {
+        data->finished = true;
+
+        if(data->cancelEvent != 0) {
+            svcCloseHandle(data->cancelEvent);
+            data->cancelEvent = 0;
+        }
+    }
+
+    return res;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#define SAMPLE_STATUS_MEDIA_SD 0
+#define SAMPLE_STATUS_MEDIA_CTR_NAND 1
+#define SAMPLE_STATUS_MEDIA_TWL_NAND 2
+#define SAMPLE_STATUS_MEDIA_TWL_PHOTO 3
+
+#define SAMPLE_STATUS_MEDIA_COUNT 4
+
+typedef struct sample_status_snapshot_s {
+    bool batteryCharging;
+    u8 batteryLevel;
+
+    bool wifiConnected;
+    u8 wifiStrength;
+
+    bool freeSpaceValid[SAMPLE_STATUS_MEDIA_COUNT];
+    u64 freeSpace[SAMPLE_STATUS_MEDIA_COUNT];
+} sample_status_snapshot;
+
+typedef struct sample_status_data_s {
+    // Only written by the sampler, which makes sequence odd while it updates snapshot.
+    volatile u32 sequence;
+    sample_status_snapshot snapshot;
+
+    volatile bool finished;
+    Result result;
+    Handle cancelEvent;
+} sample_status_data;
+
+Result task_sample_status(sample_status_data* data);
+// Copies the snapshot if it was published after *sequence, returning whether it was. Never blocks.
+bool task_sample_status_read(sample_status_data* data, sample_status_snapshot* snapshot, u32* sequence);
@@ -0,0 +1,263 @@
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <3ds.h>
+
+#include "capturecam.h"
+#include "scanqr.h"
+#include "task.h"
+#include "../error.h"
+#include "../grayscale.h"
+
+#define EVENT_CANCEL 0
+#define EVENT_FRAME 1
+
+#define EVENT_COUNT 2
+
+#define FRAME_TIMEOUT_NS 100000000
+
+typedef struct {
+    u8 data[SCAN_QR_PARTS_MAX][QUIRC_MAX_PAYLOAD];
+    u32 lengths[SCAN_QR_PARTS_MAX];
+    int parity;
+} scan_qr_parts;
+
+static void task_scan_qr_reset_parts(scan_qr_data* data, scan_qr_parts* parts, u32 total, int parity) {
+    memset(parts->lengths, 0, sizeof(parts->lengths));
+    parts->parity = parity;
+
+    data->partsFound = 0;
+    data->partsTotal = total;
+}
+
+static void task_scan_qr_add_part(scan_qr_data* data, scan_qr_parts* parts, struct quirc_data* qrData) {
+    if(qrData->sa_index >= qrData->sa_size) {
+        return;
+    }
+
+    // A part from another sequence restarts collection.
+    if((u32) qrData->sa_size != data->partsTotal || qrData->sa_parity != parts->parity) {
+        task_scan_qr_reset_parts(data, parts, (u32) qrData->sa_size, qrData->sa_parity);
+    }
+
+    // Empty parts are stored with their terminator so they still count as found.
+    if(parts->lengths[qrData->sa_index] == 0) {
+        memcpy(parts->data[qrData->sa_index], qrData->payload, (size_t) qrData->payload_len);
+        parts->lengths[qrData->sa_index] = (u32) qrData->payload_len + 1;
+
+        data->partsFound++;
+    }
+}
+
+// Joins a completed sequence into the payload, returning false if its parity does not match.
+static bool task_scan_qr_join_parts(scan_qr_data* data, scan_qr_parts* parts) {
+    size_t len = 0;
+    u8 parity = 0;
+
+    for(u32 i = 0; i < data->partsTotal; i++) {
+        u32 partLen = parts->lengths[i] - 1;
+
+        for(u32 j = 0; j < partLen; j++) {
+            parity ^= parts->data[i][j];
+        }
+
+        memcpy(&data->payload[len], parts->data[i], partLen);
+        len += partLen;
+    }
+
+    data->payload[len] = '\0';
+
+    return parity == parts->parity;
+}
+
+static int task_scan_qr_compare_codes(const void* a, const void* b) {
+    const struct quirc_code* codeA = (const struct quirc_code*) a;
+    const struct quirc_code* codeB = (const struct quirc_code*) b;
+
+    // Reading order: top to bottom, then left to right.
+    if(codeA->corners[0].y != codeB->corners[0].y) {
+        return codeA->corners[0].y - codeB->corners[0].y;
+    }
+
+    return codeA->corners[0].x - codeB->corners[0].x;
+}
+
+static void task_scan_qr_thread(void* arg) {
+    scan_qr_data* data = (scan_qr_data*) arg;
+    capture_cam_data* capture = data->capture;
+
+    Handle events[EVENT_COUNT] = {data->cancelEvent, capture->frameEvent};
+
+    Result res = 0;
+
+    struct quirc* qrContext = quirc_new();
+    scan_qr_parts* parts = (scan_qr_parts*) calloc(1, sizeof(scan_qr_parts));
+    struct quirc_code* codes = (struct quirc_code*) calloc(SCAN_QR_PARTS_MAX, sizeof(struct quirc_code));
+    if(qrContext != NULL && parts != NULL && codes != NULL) {
+        if(quirc_resize(qrContext, capture->width, capture->height) == 0) {
+            u32 lastFrame = capture->frameCount;
+
+            bool cancelRequested = false;
+            while(!task_is_quit_all() && !cancelRequested && !capture->finished && !data->found && R_SUCCEEDED(res)) {
+                svcWaitSynchronization(task_get_pause_event(), U64_MAX);
+
+                s32 index = 0;
+                if(R_FAILED(res = svcWaitSynchronizationN(&index, events, EVENT_COUNT, false, FRAME_TIMEOUT_NS))) {
+                    // Time out periodically to notice the capture task stopping.
+                    if(R_DESCRIPTION(res) == RD_TIMEOUT) {
+                        res = 0;
+                    }
+
+                    continue;
+                }
+
+                if(index == EVENT_CANCEL) {
+                    cancelRequested = true;
+                    break;
+                }
+
+                u64 startTime = osGetTime();
+
+                int w = 0;
+                int h = 0;
+                uint8_t* qrBuf = quirc_begin(qrContext, &w, &h);
+
+                // Only the newest frame is converted; frames received while decoding are dropped.
+                u32 frame = 0;
+                const u16* buffer = task_capture_cam_acquire(capture, &frame);
+                if(buffer == NULL) {
+                    continue;
+                }
+
+                if(frame != lastFrame) {
+                    for(int y = 0; y < h; y++) {
+                        grayscale_convert_rgb565_row(&qrBuf[y * w], &buffer[y * capture->width], w);
+                    }
+                }
+
+                task_capture_cam_release(capture, buffer);
+
+                if(frame == lastFrame) {
+                    continue;
+                }
+
+                data->framesSeen += frame - lastFrame;
+                lastFrame = frame;
+
+                quirc_end(qrContext);
+
+                int qrCount = quirc_count(qrContext);
+                if(qrCount > SCAN_QR_PARTS_MAX) {
+                    qrCount = SCAN_QR_PARTS_MAX;
+                }
+
+                for(int i = 0; i < qrCount; i++) {
+                    quirc_extract(qrContext, i, &codes[i]);
+                }
+
+                qsort(codes, (size_t) qrCount, sizeof(struct quirc_code), task_scan_qr_compare_codes);
+
+                // Standalone codes are only used when no sequence is being collected.
+                size_t len = 0;
+                for(int i = 0; i < qrCount; i++) {
+                    struct quirc_data qrData;
+                    if(quirc_decode(&codes[i], &qrData) != QUIRC_SUCCESS) {
+                        continue;
+                    }
+
+                    if(qrData.sa_size > 0) {
+                        task_scan_qr_add_part(data, parts, &qrData);
+                    } else if(data->partsTotal == 0 && qrData.payload_len > 0) {
+                        if(len > 0) {
+                            data->payload[len++] = '\n';
+                        }
+
+                        memcpy(&data->payload[len], qrData.payload, (size_t) qrData.payload_len);
+                        len += (size_t) qrData.payload_len;
+                    }
+                }
+
+                if(data->partsTotal > 0) {
+                    if(data->partsFound == data->partsTotal) {
+                        if(task_scan_qr_join_parts(data, parts)) {
+                            data->found = true;
+                        } else {
+                            task_scan_qr_reset_parts(data, parts, 0, 0);
+                        }
+                    }
+                } else if(len > 0) {
+                    data->payload[len] = '\0';
+                    data->found = true;
+                }
+
+                data->framesDecoded++;
+                data->decodeMs = (u32) (osGetTime() - startTime);
+            }
+        } else {
+            res = R_APP_OUT_OF_MEMORY;
+        }
+    } else {
+        res = R_APP_OUT_OF_MEMORY;
+    }
+
+    if(codes != NULL) {
+        free(codes);
+    }
+
+    if(parts != NULL) {
+        free(parts);
+    }
+
+    if(qrContext != NULL) {
+        quirc_destroy(qrContext);
+    }
+
+    svcCloseHandle(data->cancelEvent);
+
+    data->result = res;
+    data->finished = true;
+}
+
+Result task_scan_qr(scan_qr_data* data) {
+    if(data == NULL || data->capture == NULL || data->capture->finished) {
+        return R_APP_INVALID_ARGUMENT;
+    }
+
+    if(data->payload == NULL && (data->payload = (char*) calloc(1, SCAN_QR_PAYLOAD_MAX + 1)) == NULL) {
+        return R_APP_OUT_OF_MEMORY;
+    }
+
+    data->found = false;
+    data->payload[0] = '\0';
+
+    data->partsFound = 0;
+    data->partsTotal = 0;
+
+    data->framesSeen = 0;
+    data->framesDecoded = 0;
+    data->decodeMs = 0;
+
+    data->finished = false;
+    data->result = 0;
+    data->cancelEvent = 0;
+
+    Result res = 0;
+
+    if(R_SUCCEEDED(res = svcCreateEvent(&data->cancelEvent, RESET_STICKY))) {
+        if(threadCreate(task_scan_qr_thread, data, 0x10000, 0x19, 1, true) == NULL) {
+            res = R_APP_THREAD_CREATE_FAILED;
+        }
+    }
+
+    if(R_FAILED(res)) {
+        data->finished = true;
+
+        if(data->cancelEvent != 0) {
+            svcCloseHandle(data->cancelEvent);
+            data->cancelEvent = 0;
+        }
+    }
+
+    return res;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "../../libs/quirc/quirc.h"
+
+typedef struct capture_cam_data_s capture_cam_data;
+
+// Structured append allows up to 16 codes per sequence.
+#define SCAN_QR_PARTS_MAX 16
+#define SCAN_QR_PAYLOAD_MAX (SCAN_QR_PARTS_MAX * QUIRC_MAX_PAYLOAD)
+
+typedef struct scan_qr_data_s {
+    capture_cam_data* capture;
+
+    // Set when a complete payload has been decoded; payload is valid once the task has finished.
+    // A payload is either a whole structured append sequence, or every standalone code visible
+    // in one frame joined by newlines. The buffer is allocated by the task and freed by the caller.
+    volatile bool found;
+    char* payload;
+
+    // Parts of the structured append sequence collected so far; partsTotal is 0 until one is seen.
+    volatile u32 partsFound;
+    volatile u32 partsTotal;
+
+    // Frames received from the camera, frames run through the decoder, and the duration of the last decode.
+    volatile u32 framesSeen;
+    volatile u32 framesDecoded;
+    volatile u32 decodeMs;
+
+    volatile bool finished;
+    Result result;
+    Handle cancelEvent;
+} scan_qr_data;
+
+Result task_scan_qr(scan_qr_data* data);
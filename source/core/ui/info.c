@@ -1,5 +1,6 @@
 #include <malloc.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <3ds.h>
 
@@ -14,6 +15,8 @@ typedef struct {
     void* data;
     float progress;
     char text[PROGRESS_TEXT_MAX];
+    float lastProgress;
+    char lastText[PROGRESS_TEXT_MAX];
     void (*update)(ui_view* view, void* data, float* progress, char* text);
     void (*drawTop)(ui_view* view, void* data, float x1, float y1, float x2, float y2);
 } info_data;
@@ -21,6 +24,14 @@ typedef struct {
 static void info_update(ui_view* view, void* data, float bx1, float by1, float bx2, float by2) {
     info_data* infoData = (info_data*) data;
 
+    // Checked before the update callback, as it may destroy the view.
+    if(infoData->progress != infoData->lastProgress || strncmp(infoData->text, infoData->lastText, PROGRESS_TEXT_MAX) != 0) {
+        infoData->lastProgress = infoData->progress;
+        strncpy(infoData->lastText, infoData->text, PROGRESS_TEXT_MAX);
+
+        ui_invalidate();
+    }
+
     if(infoData->update != NULL) {
         infoData->update(view, infoData->data, &infoData->progress, infoData->text);
     }
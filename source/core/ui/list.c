@@ -1,30 +1,260 @@
+#include <ctype.h>
 #include <malloc.h>
+#include <string.h>
 
 #include <3ds.h>
 
 #include "error.h"
+#include "kbd.h"
 #include "list.h"
 #include "ui.h"
 #include "../screen.h"
 #include "../linkedlist.h"
 #include "../../fbi/resources.h"
 
+#define LIST_FILTER_MAX 64
+
 typedef struct {
     void* data;
     linked_list items;
+    // Array view of items, rebuilt only when the list has been modified since. Appended items are added
+    // without a rebuild.
+    list_item** itemArray;
+    u32 itemArraySize;
+    u32 itemArrayCapacity;
+    unsigned int itemArrayVersion;
+    unsigned int itemArrayIndexVersion;
+    // Node of the last itemArray entry, from which appended items are reached.
+    linked_list_node* itemArrayTail;
+    bool itemArrayValid;
+    // Lowercased search text of the first searchCount entries of itemArray, stored at searchOffsets in searchPool.
+    u32* searchOffsets;
+    u32 searchOffsetsCapacity;
+    u32 searchCount;
+    char* searchPool;
+    u32 searchPoolSize;
+    u32 searchPoolCapacity;
+    // Entries of itemArray matching appliedFilter, out of the first filterChecked.
+    u32* filterIndices;
+    u32 filterIndicesCapacity;
+    list_item** filterItems;
+    u32 filterItemsCapacity;
+    u32 filterSize;
+    u32 filterChecked;
+    char appliedFilter[LIST_FILTER_MAX];
+    char filter[LIST_FILTER_MAX];
+    bool filterable;
+    void (*searchText)(list_item* item, char* text, size_t size);
+    // The rows shown, either itemArray or filterItems.
+    list_item** rows;
+    u32 rowCount;
     u32 selectedIndex;
     list_item* selectedItem;
     u32 selectionScroll;
     u64 nextSelectionScrollResetTime;
+    list_item* selectedWidthItem;
+    unsigned int selectedWidthVersion;
+    float selectedWidth;
     float scrollPos;
     u32 lastScrollTouchY;
+    unsigned int lastVersion;
     u64 nextActionTime;
     void (*update)(ui_view* view, void* data, linked_list* items, list_item* selected, bool selectedTouched);
     void (*drawTop)(ui_view* view, void* data, float x1, float y1, float x2, float y2, list_item* selected);
 } list_data;
 
-static void list_validate(list_data* listData, float by1, float by2) {
+static bool list_reserve(void** array, u32* capacity, u32 size, size_t elementSize) {
+    if(size <= *capacity) {
+        return true;
+    }
+
+    u32 newCapacity = *capacity > 0 ? *capacity : 64;
+    while(newCapacity < size) {
+        newCapacity *= 2;
+    }
+
+    void* newArray = realloc(*array, newCapacity * elementSize);
+    if(newArray == NULL) {
+        return false;
+    }
+
+    *array = newArray;
+    *capacity = newCapacity;
+    return true;
+}
+
+static void list_reset_search(list_data* listData) {
+    listData->searchCount = 0;
+    listData->searchPoolSize = 0;
+
+    listData->filterSize = 0;
+    listData->filterChecked = 0;
+}
+
+static void list_update_item_array(list_data* listData) {
+    // Items may be appended by a populate task while this runs. The versions are read before the size, and
+    // new nodes are linked before the size is incremented, so anything missed here is picked up next time.
+    unsigned int version = linked_list_version(&listData->items);
+    unsigned int indexVersion = linked_list_index_version(&listData->items);
+    if(listData->itemArrayValid && listData->itemArrayVersion == version) {
+        return;
+    }
+
     u32 size = linked_list_size(&listData->items);
+    if(!list_reserve((void**) &listData->itemArray, &listData->itemArrayCapacity, size, sizeof(list_item*))) {
+        size = listData->itemArrayCapacity;
+    }
+
+    if(listData->itemArrayValid && indexVersion == listData->itemArrayIndexVersion && size >= listData->itemArraySize) {
+        // Items were only appended, so the new ones follow the previous last node.
+        linked_list_node* node = listData->itemArrayTail != NULL ? listData->itemArrayTail->next : listData->items.first;
+        while(listData->itemArraySize < size && node != NULL) {
+            listData->itemArray[listData->itemArraySize++] = (list_item*) node->value;
+            listData->itemArrayTail = node;
+
+            node = node->next;
+        }
+    } else {
+        listData->itemArraySize = 0;
+        listData->itemArrayTail = NULL;
+
+        for(linked_list_node* node = listData->items.first; node != NULL && listData->itemArraySize < size; node = node->next) {
+            listData->itemArray[listData->itemArraySize++] = (list_item*) node->value;
+            listData->itemArrayTail = node;
+        }
+
+        list_reset_search(listData);
+    }
+
+    listData->itemArrayVersion = version;
+    listData->itemArrayIndexVersion = indexVersion;
+    listData->itemArrayValid = true;
+}
+
+static void list_normalize(char* dst, const char* src, size_t size) {
+    size_t i = 0;
+    for(; i < size - 1 && src[i] != '\0'; i++) {
+        dst[i] = (char) tolower((unsigned char) src[i]);
+    }
+
+    dst[i] = '\0';
+}
+
+// Indexes items added since the last call; earlier entries keep their search text.
+static void list_update_search(list_data* listData) {
+    if(!list_reserve((void**) &listData->searchOffsets, &listData->searchOffsetsCapacity, listData->itemArraySize, sizeof(u32))) {
+        return;
+    }
+
+    char text[LIST_ITEM_NAME_MAX + 64];
+
+    while(listData->searchCount < listData->itemArraySize) {
+        list_item* item = listData->itemArray[listData->searchCount];
+
+        size_t len = strnlen(item->name, LIST_ITEM_NAME_MAX - 1);
+        memcpy(text, item->name, len);
+
+        if(listData->searchText != NULL) {
+            text[len++] = '\n';
+            listData->searchText(item, text + len, sizeof(text) - len);
+            len += strlen(text + len);
+        }
+
+        text[len] = '\0';
+
+        if(!list_reserve((void**) &listData->searchPool, &listData->searchPoolCapacity, listData->searchPoolSize + len + 1, sizeof(char))) {
+            return;
+        }
+
+        list_normalize(listData->searchPool + listData->searchPoolSize, text, len + 1);
+
+        listData->searchOffsets[listData->searchCount++] = listData->searchPoolSize;
+        listData->searchPoolSize += len + 1;
+    }
+}
+
+static bool list_matches(list_data* listData, u32 index) {
+    return index < listData->searchCount && strstr(listData->searchPool + listData->searchOffsets[index], listData->appliedFilter) != NULL;
+}
+
+static void list_update_rows(list_data* listData) {
+    list_update_item_array(listData);
+
+    if(listData->filter[0] == '\0') {
+        listData->appliedFilter[0] = '\0';
+
+        listData->rows = listData->itemArray;
+        listData->rowCount = listData->itemArraySize;
+        return;
+    }
+
+    list_update_search(listData);
+
+    if(strcmp(listData->filter, listData->appliedFilter) != 0) {
+        if(listData->appliedFilter[0] != '\0' && strstr(listData->filter, listData->appliedFilter) != NULL) {
+            strncpy(listData->appliedFilter, listData->filter, LIST_FILTER_MAX);
+
+            // Anything matching the longer filter also matched the previous one, so only current matches are checked.
+            u32 kept = 0;
+            for(u32 i = 0; i < listData->filterSize; i++) {
+                if(list_matches(listData, listData->filterIndices[i])) {
+                    listData->filterIndices[kept] = listData->filterIndices[i];
+                    listData->filterItems[kept] = listData->filterItems[i];
+                    kept++;
+                }
+            }
+
+            listData->filterSize = kept;
+        } else {
+            strncpy(listData->appliedFilter, listData->filter, LIST_FILTER_MAX);
+
+            listData->filterSize = 0;
+            listData->filterChecked = 0;
+        }
+    }
+
+    if(list_reserve((void**) &listData->filterIndices, &listData->filterIndicesCapacity, listData->searchCount, sizeof(u32))
+       && list_reserve((void**) &listData->filterItems, &listData->filterItemsCapacity, listData->searchCount, sizeof(list_item*))) {
+        for(; listData->filterChecked < listData->searchCount; listData->filterChecked++) {
+            if(list_matches(listData, listData->filterChecked)) {
+                listData->filterIndices[listData->filterSize] = listData->filterChecked;
+                listData->filterItems[listData->filterSize] = listData->itemArray[listData->filterChecked];
+                listData->filterSize++;
+            }
+        }
+    }
+
+    listData->rows = listData->filterItems;
+    listData->rowCount = listData->filterSize;
+}
+
+// The selected item usually stays where it was, so its last index is checked before searching.
+static int list_index_of(list_data* listData, list_item* item) {
+    if(listData->selectedIndex < listData->rowCount && listData->rows[listData->selectedIndex] == item) {
+        return (int) listData->selectedIndex;
+    }
+
+    for(u32 i = 0; i < listData->rowCount; i++) {
+        if(listData->rows[i] == item) {
+            return (int) i;
+        }
+    }
+
+    return -1;
+}
+
+static void list_filter_response(ui_view* view, void* data, SwkbdButton button, const char* response) {
+    list_data* listData = (list_data*) data;
+
+    if(button == SWKBD_BUTTON_CONFIRM) {
+        list_normalize(listData->filter, response, LIST_FILTER_MAX);
+    }
+}
+
+static void list_validate(list_data* listData, float by1, float by2) {
+    list_update_rows(listData);
+
+    u32 size = listData->rowCount;
 
     if(size == 0 || listData->selectedIndex < 0) {
         listData->selectedIndex = 0;
@@ -46,7 +276,7 @@ static void list_validate(list_data* listData, float by1, float by2) {
         if(listData->selectedItem != NULL) {
             u32 oldIndex = listData->selectedIndex;
 
-            int index = linked_list_index_of(&listData->items, listData->selectedItem);
+            int index = list_index_of(listData, listData->selectedItem);
             if(index != -1) {
                 found = true;
                 listData->selectedIndex = (u32) index;
@@ -58,7 +288,7 @@ static void list_validate(list_data* listData, float by1, float by2) {
         }
 
         if(!found) {
-            listData->selectedItem = linked_list_get(&listData->items, listData->selectedIndex);
+            listData->selectedItem = listData->rows[listData->selectedIndex];
 
             listData->selectionScroll = 0;
             listData->nextSelectionScrollResetTime = 0;
@@ -86,19 +316,45 @@ static void list_validate(list_data* listData, float by1, float by2) {
     }
 }
 
+// Names are not changed once an item is added, so the width is only measured again when the selection or list changes.
+static float list_get_selected_width(list_data* listData) {
+    if(listData->selectedWidthItem != listData->selectedItem || listData->selectedWidthVersion != listData->itemArrayVersion) {
+        screen_get_string_size(&listData->selectedWidth, NULL, listData->selectedItem->name, 0.5f, 0.5f);
+
+        listData->selectedWidthItem = listData->selectedItem;
+        listData->selectedWidthVersion = listData->itemArrayVersion;
+    }
+
+    return listData->selectedWidth;
+}
+
 static void list_update(ui_view* view, void* data, float bx1, float by1, float bx2, float by2) {
     list_data* listData = (list_data*) data;
 
-    u32 size = linked_list_size(&listData->items);
-
     list_validate(listData, by1, by2);
 
+    u32 size = listData->rowCount;
+
+    // Items may have been added, removed or sorted by a callback or a populating task since the last update.
+    if(listData->itemArrayVersion != listData->lastVersion) {
+        listData->lastVersion = listData->itemArrayVersion;
+
+        ui_invalidate();
+    }
+
+    if(listData->filterable && (hidKeysDown() & KEY_Y)) {
+        kbd_display("Filter", listData->filter, SWKBD_TYPE_NORMAL, 0, SWKBD_ANYTHING, LIST_FILTER_MAX, listData, list_filter_response);
+    }
+
+    list_item* lastSelectedItem = listData->selectedItem;
+    float lastScrollPos = listData->scrollPos;
+    u32 lastSelectionScroll = listData->selectionScroll;
+
     bool selectedTouched = false;
     if(size > 0) {
         bool scrolls = false;
         if(listData->selectedItem != NULL) {
-            float itemWidth;
-            screen_get_string_size(&itemWidth, NULL, listData->selectedItem->name, 0.5f, 0.5f);
+            float itemWidth = list_get_selected_width(listData);
             if(itemWidth > bx2 - bx1) {
                 scrolls = true;
 
@@ -184,8 +440,8 @@ static void list_update(ui_view* view, void* data, float bx1, float by1, float b
             listData->lastScrollTouchY = pos.py;
         }
 
-        if(listData->selectedIndex != lastSelectedIndex) {
-            listData->selectedItem = linked_list_get(&listData->items, listData->selectedIndex);
+        if(listData->selectedIndex != lastSelectedIndex && listData->selectedIndex < size) {
+            listData->selectedItem = listData->rows[listData->selectedIndex];
 
             listData->selectionScroll = 0;
             listData->nextSelectionScrollResetTime = 0;
@@ -194,6 +450,11 @@ static void list_update(ui_view* view, void* data, float bx1, float by1, float b
         list_validate(listData, by1, by2);
     }
 
+    if(listData->selectedItem != lastSelectedItem || listData->scrollPos != lastScrollPos || listData->selectionScroll != lastSelectionScroll) {
+        ui_invalidate();
+    }
+
+    // The update callback may destroy the view, so listData must not be used after it.
     if(listData->update != NULL) {
         listData->update(view, listData->data, &listData->items, listData->selectedItem, selectedTouched);
     }
@@ -215,17 +476,16 @@ static void list_draw_bottom(ui_view* view, void* data, float x1, float y1, floa
     list_validate(listData, y1, y2);
 
     float fontHeight = screen_get_font_height(0.5f);
-    float y = y1 - listData->scrollPos;
-
-    linked_list_iter iter;
-    linked_list_iterate(&listData->items, &iter);
 
-    while(linked_list_iter_has_next(&iter)) {
+    // Only the rows inside the view are visited, starting from the first one scrolled into it.
+    u32 first = listData->scrollPos > 0 ? (u32) (listData->scrollPos / fontHeight) : 0;
+    for(u32 i = first; i < listData->rowCount; i++) {
+        float y = y1 - listData->scrollPos + i * fontHeight;
         if(y > y2) {
             break;
         }
 
-        list_item* item = linked_list_iter_next(&iter);
+        list_item* item = listData->rows[i];
 
         if(y > y1 - fontHeight) {
             float x = x1 + 2;
@@ -241,11 +501,9 @@ static void list_draw_bottom(ui_view* view, void* data, float x1, float y1, floa
                 screen_draw_texture(TEXTURE_SELECTION_OVERLAY, (x1 + x2 - selectionOverlayWidth) / 2, y, selectionOverlayWidth, fontHeight);
             }
         }
-
-        y += fontHeight;
     }
 
-    u32 size = linked_list_size(&listData->items);
+    u32 size = listData->rowCount;
     if(size > 0) {
         float totalHeight = size * fontHeight;
         float viewHeight = y2 - y1;
@@ -275,12 +533,41 @@ ui_view* list_display(const char* name, const char* info, void* data, void (*upd
 
     listData->data = data;
     linked_list_init(&listData->items);
+    listData->itemArray = NULL;
+    listData->itemArraySize = 0;
+    listData->itemArrayCapacity = 0;
+    listData->itemArrayVersion = 0;
+    listData->itemArrayIndexVersion = 0;
+    listData->itemArrayTail = NULL;
+    listData->itemArrayValid = false;
+    listData->searchOffsets = NULL;
+    listData->searchOffsetsCapacity = 0;
+    listData->searchCount = 0;
+    listData->searchPool = NULL;
+    listData->searchPoolSize = 0;
+    listData->searchPoolCapacity = 0;
+    listData->filterIndices = NULL;
+    listData->filterIndicesCapacity = 0;
+    listData->filterItems = NULL;
+    listData->filterItemsCapacity = 0;
+    listData->filterSize = 0;
+    listData->filterChecked = 0;
+    listData->appliedFilter[0] = '\0';
+    listData->filter[0] = '\0';
+    listData->filterable = false;
+    listData->searchText = NULL;
+    listData->rows = NULL;
+    listData->rowCount = 0;
     listData->selectedIndex = 0;
     listData->selectedItem = NULL;
     listData->selectionScroll = 0;
     listData->nextSelectionScrollResetTime = 0;
+    listData->selectedWidthItem = NULL;
+    listData->selectedWidthVersion = 0;
+    listData->selectedWidth = 0;
     listData->scrollPos = 0;
     listData->lastScrollTouchY = 0;
+    listData->lastVersion = 0;
     listData->update = update;
     listData->drawTop = drawTop;
 
@@ -296,9 +583,42 @@ ui_view* list_display(const char* name, const char* info, void* data, void (*upd
     return view;
 }
 
+void list_enable_filter(ui_view* view, void (*searchText)(list_item* item, char* text, size_t size)) {
+    if(view != NULL) {
+        list_data* listData = (list_data*) view->data;
+
+        listData->filterable = true;
+        listData->searchText = searchText;
+
+        list_reset_search(listData);
+    }
+}
+
 void list_destroy(ui_view* view) {
     if(view != NULL) {
-        linked_list_destroy(&((list_data*) view->data)->items);
+        list_data* listData = (list_data*) view->data;
+
+        linked_list_destroy(&listData->items);
+
+        if(listData->itemArray != NULL) {
+            free(listData->itemArray);
+        }
+
+        if(listData->searchOffsets != NULL) {
+            free(listData->searchOffsets);
+        }
+
+        if(listData->searchPool != NULL) {
+            free(listData->searchPool);
+        }
+
+        if(listData->filterIndices != NULL) {
+            free(listData->filterIndices);
+        }
+
+        if(listData->filterItems != NULL) {
+            free(listData->filterItems);
+        }
 
         free(view->data);
         ui_destroy(view);
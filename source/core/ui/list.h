@@ -13,4 +13,6 @@ typedef struct list_item_s {
 
 ui_view* list_display(const char* name, const char* info, void* data, void (*update)(ui_view* view, void* data, linked_list* items, list_item* selected, bool selectedTouched),
                                                                       void (*drawTop)(ui_view* view, void* data, float x1, float y1, float x2, float y2, list_item* selected));
+// Lets Y filter the list by a case-insensitive substring of item names, plus any text searchText adds for an item.
+void list_enable_filter(ui_view* view, void (*searchText)(list_item* item, char* text, size_t size));
 void list_destroy(ui_view* view);
\ No newline at end of file
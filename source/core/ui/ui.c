@@ -9,6 +9,7 @@
 #include "../error.h"
 #include "../screen.h"
 #include "../data/smdh.h"
+#include "../task/task.h"
 #include "../../fbi/resources.h"
 
 #define MAX_UI_VIEWS 16
@@ -18,21 +19,72 @@ static int ui_stack_top = -1;
 
 static Handle ui_stack_mutex = 0;
 
-static u64 ui_free_space_last_update = 0;
 static char ui_free_space_buffer[128];
 
+static const char* ui_free_space_names[SAMPLE_STATUS_MEDIA_COUNT] = {
+        "SD",
+        "CTR NAND",
+        "TWL NAND",
+        "TWL Photo"
+};
+
+// Battery, Wi-Fi and free space are sampled by a background task; the UI only copies its snapshot.
+static sample_status_data ui_status_data;
+static bool ui_status_sampling = false;
+static u32 ui_status_sequence = 0;
+
+static time_t ui_status_time = 0;
+static u32 ui_status_battery_icon = TEXTURE_BATTERY_0;
+static u32 ui_status_wifi_icon = TEXTURE_WIFI_DISCONNECTED;
+
 static u64 ui_fade_begin_time = 0;
 static u8 ui_fade_alpha = 0;
 
+// Frames are only rendered when something on screen may have changed.
+static volatile bool ui_dirty = true;
+
+static u32 ui_frames = 0;
+static u32 ui_skipped_frames = 0;
+
+static aptHookCookie ui_apt_cookie;
+
+static void ui_apt_hook(APT_HookType hook, void* param) {
+    switch(hook) {
+        case APTHOOK_ONRESTORE:
+        case APTHOOK_ONWAKEUP:
+            ui_invalidate();
+            break;
+        default:
+            break;
+    }
+}
+
 void ui_init() {
     if(ui_stack_mutex == 0) {
         svcCreateMutex(&ui_stack_mutex, false);
     }
 
     ui_fade_begin_time = osGetTime();
+
+    ui_dirty = true;
+    aptHook(&ui_apt_cookie, ui_apt_hook, NULL);
+
+    ui_status_sequence = 0;
+    ui_status_sampling = R_SUCCEEDED(task_sample_status(&ui_status_data));
 }
 
 void ui_exit() {
+    if(ui_status_sampling) {
+        svcSignalEvent(ui_status_data.cancelEvent);
+        while(!ui_status_data.finished) {
+            svcSleepThread(1000000);
+        }
+
+        ui_status_sampling = false;
+    }
+
+    aptUnhook(&ui_apt_cookie);
+
     if(ui_stack_mutex != 0) {
         svcCloseHandle(ui_stack_mutex);
         ui_stack_mutex = 0;
@@ -89,6 +141,8 @@ bool ui_push(ui_view* view) {
         ui_stack[++ui_stack_top] = view;
 
         svcClearEvent(view->active);
+
+        ui_invalidate();
     }
 
     svcReleaseMutex(ui_stack_mutex);
@@ -103,11 +157,37 @@ void ui_pop() {
         svcSignalEvent(ui_stack[ui_stack_top]->active);
 
         ui_stack[ui_stack_top--] = NULL;
+
+        ui_invalidate();
     }
 
     svcReleaseMutex(ui_stack_mutex);
 }
 
+#ifdef UI_FRAME_STATS
+// Debug overlay, built with -DUI_FRAME_STATS: the previous frame's rendering cost and the share of updates that
+// skipped rendering, right-aligned at x.
+static void ui_draw_frame_stats(float x, float y, float height) {
+    u32 drawCalls = 0;
+    u32 quads = 0;
+    u32 cmdBufBytes = 0;
+    screen_get_frame_stats(&drawCalls, &quads, &cmdBufBytes);
+
+    u32 frames = 0;
+    u32 skippedFrames = 0;
+    ui_get_frame_stats(&frames, &skippedFrames);
+
+    char statsText[96];
+    snprintf(statsText, sizeof(statsText), "%lu draws, %lu quads, %lu B cmd, %lu%% skipped", drawCalls, quads, cmdBufBytes,
+             frames > 0 ? (u32) ((u64) skippedFrames * 100 / frames) : 0);
+
+    float statsWidth;
+    float statsHeight;
+    screen_get_string_size(&statsWidth, &statsHeight, statsText, 0.35f, 0.35f);
+    screen_draw_string(statsText, x - statsWidth, y + (height - statsHeight) / 2, 0.35f, 0.35f, COLOR_TEXT, true);
+}
+#endif
+
 static void ui_draw_top(ui_view* ui) {
     screen_select(GFX_TOP);
 
@@ -157,8 +237,7 @@ static void ui_draw_top(ui_view* ui) {
     screen_get_string_size(&verWidth, &verHeight, verText, 0.5f, 0.5f);
     screen_draw_string(verText, topScreenTopBarX + 2, topScreenTopBarY + (topScreenTopBarHeight - verHeight) / 2, 0.5f, 0.5f, COLOR_TEXT, true);
 
-    time_t t = time(NULL);
-    char* timeText = ctime(&t);
+    char* timeText = ctime(&ui_status_time);
     timeText[strlen(timeText) - 1] = '\0';
 
     float timeTextWidth;
@@ -166,16 +245,7 @@ static void ui_draw_top(ui_view* ui) {
     screen_get_string_size(&timeTextWidth, &timeTextHeight, timeText, 0.5f, 0.5f);
     screen_draw_string(timeText, topScreenTopBarX + (topScreenTopBarWidth - timeTextWidth) / 2, topScreenTopBarY + (topScreenTopBarHeight - timeTextHeight) / 2, 0.5f, 0.5f, COLOR_TEXT, true);
 
-    u32 batteryIcon = 0;
-    u8 batteryChargeState = 0;
-    u8 batteryLevel = 0;
-    if(R_SUCCEEDED(PTMU_GetBatteryChargeState(&batteryChargeState)) && batteryChargeState) {
-        batteryIcon = TEXTURE_BATTERY_CHARGING;
-    } else if(R_SUCCEEDED(PTMU_GetBatteryLevel(&batteryLevel))) {
-        batteryIcon = TEXTURE_BATTERY_0 + batteryLevel;
-    } else {
-        batteryIcon = TEXTURE_BATTERY_0;
-    }
+    u32 batteryIcon = ui_status_battery_icon;
 
     u32 batteryWidth;
     u32 batteryHeight;
@@ -185,13 +255,7 @@ static void ui_draw_top(ui_view* ui) {
     float batteryY = topScreenTopBarY + (topScreenTopBarHeight - batteryHeight) / 2;
     screen_draw_texture(batteryIcon, batteryX, batteryY, batteryWidth, batteryHeight);
 
-    u32 wifiIcon = 0;
-    u32 wifiStatus = 0;
-    if(R_SUCCEEDED(ACU_GetWifiStatus(&wifiStatus)) && wifiStatus) {
-        wifiIcon = TEXTURE_WIFI_0 + osGetWifiStrength();
-    } else {
-        wifiIcon = TEXTURE_WIFI_DISCONNECTED;
-    }
+    u32 wifiIcon = ui_status_wifi_icon;
 
     u32 wifiWidth;
     u32 wifiHeight;
@@ -201,66 +265,15 @@ static void ui_draw_top(ui_view* ui) {
     float wifiY = topScreenTopBarY + (topScreenTopBarHeight - wifiHeight) / 2;
     screen_draw_texture(wifiIcon, wifiX, wifiY, wifiWidth, wifiHeight);
 
-    if(osGetTime() >= ui_free_space_last_update + 1000) {
-        char* currBuffer = ui_free_space_buffer;
-        FS_ArchiveResource resource = {0};
-
-        if(R_SUCCEEDED(FSUSER_GetArchiveResource(&resource, SYSTEM_MEDIATYPE_SD)) && currBuffer < ui_free_space_buffer + sizeof(ui_free_space_buffer)) {
-            if(currBuffer != ui_free_space_buffer) {
-                snprintf(currBuffer, sizeof(ui_free_space_buffer) - (currBuffer - ui_free_space_buffer), ", ");
-                currBuffer += strlen(currBuffer);
-            }
-
-            u64 size = (u64) resource.freeClusters * (u64) resource.clusterSize;
-            snprintf(currBuffer, sizeof(ui_free_space_buffer) - (currBuffer - ui_free_space_buffer), "SD: %.1f %s",
-                     ui_get_display_size(size), ui_get_display_size_units(size));
-            currBuffer += strlen(currBuffer);
-        }
-
-        if(R_SUCCEEDED(FSUSER_GetArchiveResource(&resource, SYSTEM_MEDIATYPE_CTR_NAND)) && currBuffer < ui_free_space_buffer + sizeof(ui_free_space_buffer)) {
-            if(currBuffer != ui_free_space_buffer) {
-                snprintf(currBuffer, sizeof(ui_free_space_buffer) - (currBuffer - ui_free_space_buffer), ", ");
-                currBuffer += strlen(currBuffer);
-            }
-
-            u64 size = (u64) resource.freeClusters * (u64) resource.clusterSize;
-            snprintf(currBuffer, sizeof(ui_free_space_buffer) - (currBuffer - ui_free_space_buffer), "CTR NAND: %.1f %s",
-                     ui_get_display_size(size), ui_get_display_size_units(size));
-            currBuffer += strlen(currBuffer);
-        }
-
-        if(R_SUCCEEDED(FSUSER_GetArchiveResource(&resource, SYSTEM_MEDIATYPE_TWL_NAND)) && currBuffer < ui_free_space_buffer + sizeof(ui_free_space_buffer)) {
-            if(currBuffer != ui_free_space_buffer) {
-                snprintf(currBuffer, sizeof(ui_free_space_buffer) - (currBuffer - ui_free_space_buffer), ", ");
-                currBuffer += strlen(currBuffer);
-            }
-
-            u64 size = (u64) resource.freeClusters * (u64) resource.clusterSize;
-            snprintf(currBuffer, sizeof(ui_free_space_buffer) - (currBuffer - ui_free_space_buffer), "TWL NAND: %.1f %s",
-                     ui_get_display_size(size), ui_get_display_size_units(size));
-            currBuffer += strlen(currBuffer);
-        }
-
-        if(R_SUCCEEDED(FSUSER_GetArchiveResource(&resource, SYSTEM_MEDIATYPE_TWL_PHOTO)) && currBuffer < ui_free_space_buffer + sizeof(ui_free_space_buffer)) {
-            if(currBuffer != ui_free_space_buffer) {
-                snprintf(currBuffer, sizeof(ui_free_space_buffer) - (currBuffer - ui_free_space_buffer), ", ");
-                currBuffer += strlen(currBuffer);
-            }
-
-            u64 size = (u64) resource.freeClusters * (u64) resource.clusterSize;
-            snprintf(currBuffer, sizeof(ui_free_space_buffer) - (currBuffer - ui_free_space_buffer), "TWL Photo: %.1f %s",
-                     ui_get_display_size(size), ui_get_display_size_units(size));
-            currBuffer += strlen(currBuffer);
-        }
-
-        ui_free_space_last_update = osGetTime();
-    }
-
     float freeSpaceHeight;
     screen_get_string_size(NULL, &freeSpaceHeight, ui_free_space_buffer, 0.35f, 0.35f);
 
     screen_draw_string(ui_free_space_buffer, topScreenBottomBarX + 2, topScreenBottomBarY + (topScreenBottomBarHeight - freeSpaceHeight) / 2, 0.35f, 0.35f, COLOR_TEXT, true);
 
+#ifdef UI_FRAME_STATS
+    ui_draw_frame_stats(topScreenBottomBarX + topScreenBottomBarWidth - 2, topScreenBottomBarY, topScreenBottomBarHeight);
+#endif
+
     screen_set_base_alpha(0xFF);
 }
 
@@ -335,11 +348,70 @@ static void ui_draw_bottom(ui_view* ui) {
     screen_set_base_alpha(0xFF);
 }
 
+// Refreshes the values shown in the top screen's bars, returning whether any of them changed.
+static bool ui_update_status() {
+    bool changed = false;
+
+    time_t t = time(NULL);
+    if(t != ui_status_time) {
+        ui_status_time = t;
+        changed = true;
+    }
+
+    sample_status_snapshot snapshot;
+    if(ui_status_sampling && task_sample_status_read(&ui_status_data, &snapshot, &ui_status_sequence)) {
+        if(snapshot.batteryCharging) {
+            ui_status_battery_icon = TEXTURE_BATTERY_CHARGING;
+        } else {
+            ui_status_battery_icon = TEXTURE_BATTERY_0 + snapshot.batteryLevel;
+        }
+
+        if(snapshot.wifiConnected) {
+            ui_status_wifi_icon = TEXTURE_WIFI_0 + snapshot.wifiStrength;
+        } else {
+            ui_status_wifi_icon = TEXTURE_WIFI_DISCONNECTED;
+        }
+
+        u32 len = 0;
+        ui_free_space_buffer[0] = '\0';
+
+        for(u32 i = 0; i < SAMPLE_STATUS_MEDIA_COUNT && len < sizeof(ui_free_space_buffer); i++) {
+            if(snapshot.freeSpaceValid[i]) {
+                u64 size = snapshot.freeSpace[i];
+                len += snprintf(ui_free_space_buffer + len, sizeof(ui_free_space_buffer) - len, "%s%s: %.1f %s", len > 0 ? ", " : "",
+                                ui_free_space_names[i], ui_get_display_size(size), ui_get_display_size_units(size));
+            }
+        }
+
+        changed = true;
+    }
+
+    return changed;
+}
+
+void ui_invalidate() {
+    ui_dirty = true;
+}
+
+void ui_get_frame_stats(u32* frames, u32* skippedFrames) {
+    if(frames != NULL) {
+        *frames = ui_frames;
+    }
+
+    if(skippedFrames != NULL) {
+        *skippedFrames = ui_skipped_frames;
+    }
+}
+
 bool ui_update() {
     ui_view* ui = NULL;
 
     hidScanInput();
 
+    if(hidKeysDown() || hidKeysHeld() || hidKeysUp()) {
+        ui_invalidate();
+    }
+
     ui = ui_top();
     if(ui != NULL && ui->update != NULL) {
         u32 bottomScreenTopBarHeight = 0;
@@ -354,16 +426,35 @@ bool ui_update() {
     u64 time = osGetTime();
     if(!envIsHomebrew() && time - ui_fade_begin_time < 500) {
         ui_fade_alpha = (u8) (((time - ui_fade_begin_time) / 500.0f) * 0xFF);
-    } else {
+
+        ui_invalidate();
+    } else if(ui_fade_alpha != 0xFF) {
         ui_fade_alpha = 0xFF;
+
+        ui_invalidate();
+    }
+
+    if(ui_update_status()) {
+        ui_invalidate();
     }
 
     ui = ui_top();
     if(ui != NULL) {
-        screen_begin_frame();
-        ui_draw_top(ui);
-        ui_draw_bottom(ui);
-        screen_end_frame();
+        ui_frames++;
+
+        if(ui_dirty) {
+            ui_dirty = false;
+
+            screen_begin_frame();
+            ui_draw_top(ui);
+            ui_draw_bottom(ui);
+            screen_end_frame();
+        } else {
+            // The last rendered frame is still on screen, so just keep the loop paced.
+            ui_skipped_frames++;
+
+            gspWaitForVBlank();
+        }
     }
 
     return ui != NULL;
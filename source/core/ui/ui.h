@@ -21,6 +21,10 @@ ui_view* ui_top();
 bool ui_push(ui_view* view);
 void ui_pop();
 bool ui_update();
+// Requests a redraw on the next update, for state changes the UI loop cannot see.
+void ui_invalidate();
+// Updates run and how many of them skipped rendering because nothing changed.
+void ui_get_frame_stats(u32* frames, u32* skippedFrames);
 
 const char* ui_get_display_eta(u32 seconds);
 double ui_get_display_size(u64 size);
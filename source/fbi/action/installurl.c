@@ -1,14 +1,19 @@
 #include <malloc.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <3ds.h>
+#include <jansson.h>
 
 #include "action.h"
 #include "../resources.h"
 #include "../task/uitask.h"
 #include "../../core/core.h"
 
+#define INSTALL_URL_MANIFEST_NAME "fbi-manifest.json"
+#define INSTALL_URL_MANIFEST_MAX (256 * 1024)
+
 typedef enum content_type_e {
     CONTENT_CIA,
     CONTENT_TICKET,
@@ -20,6 +25,11 @@ typedef struct {
 
     char paths[INSTALL_URLS_MAX][FILE_PATH_MAX];
 
+    u64 sizes[INSTALL_URLS_MAX];
+    u64 totalSize;
+
+    u32 skipped;
+
     void* userData;
     void (*finishedURL)(void* data, u32 index);
     void (*finishedAll)(void* data);
@@ -53,6 +63,20 @@ static void action_install_url_draw_top(ui_view* view, void* data, float x1, flo
         installData->drawTop(view, installData->userData, x1, y1, x2, y2, installData->installInfo.processed);
     } else if(installData->installInfo.processed == installData->installInfo.total) {
         float urlY = y1 + 5;
+
+        if(installData->totalSize != 0) {
+            char summary[64];
+            snprintf(summary, sizeof(summary), "%lu file(s), %.2f %s total", installData->installInfo.total,
+                     ui_get_display_size(installData->totalSize), ui_get_display_size_units(installData->totalSize));
+
+            float summaryWidth = 0;
+            float summaryHeight = 0;
+            screen_get_string_size(&summaryWidth, &summaryHeight, summary, 0.5f, 0.5f);
+            screen_draw_string(summary, x1 + (x2 - x1 - summaryWidth) / 2, urlY, 0.5f, 0.5f, COLOR_TEXT, true);
+
+            urlY += summaryHeight + 5;
+        }
+
         u32 index = 0;
         while(urlY < y2 && index < installData->installInfo.total) {
             float urlWidth = 0;
@@ -98,9 +122,18 @@ static Result action_install_url_open_dst(void* data, u32 index, void* initialRe
         installData->contentType = CONTENT_CIA;
 
         u64 titleId = 0;
-        if(R_SUCCEEDED(res = cia_get_title_id(&titleId, (u8*) initialReadBlock, installData->installInfo.bufferSize))) {
+        u16 titleVersion = 0;
+        if(R_SUCCEEDED(res = cia_get_title_id(&titleId, (u8*) initialReadBlock, installData->installInfo.bufferSize))
+           && R_SUCCEEDED(res = cia_get_title_version(&titleVersion, (u8*) initialReadBlock, installData->installInfo.bufferSize))) {
             FS_MediaType dest = fs_get_title_destination(titleId);
 
+            // When installing a batch, skip titles that are already installed at the same or a newer version.
+            AM_TitleEntry entry;
+            if(installData->installInfo.total > 1 && R_SUCCEEDED(AM_GetTitleInfo(dest, 1, &titleId, &entry)) && entry.version >= titleVersion) {
+                installData->skipped++;
+                return R_APP_SKIPPED;
+            }
+
             bool n3ds = false;
             if(R_SUCCEEDED(APT_CheckNew3DS(&n3ds)) && !n3ds && ((titleId >> 28) & 0xF) == 2) {
                 ui_view* view = prompt_display_yes_no("Confirmation", "Title is intended for New 3DS systems.\nContinue?", COLOR_TEXT, data, action_install_url_draw_top, action_install_url_n3ds_onresponse);
@@ -260,8 +293,15 @@ static void action_install_url_install_update(ui_view* view, void* data, float*
         ui_pop();
         info_destroy(view);
 
-        if(R_SUCCEEDED(installData->installInfo.result)) {
-            prompt_display_notify("Success", "Install finished.", COLOR_TEXT, NULL, NULL, NULL);
+        if(R_SUCCEEDED(installData->installInfo.result) || installData->installInfo.result == R_APP_SKIPPED) {
+            if(installData->skipped > 0) {
+                static char successText[64];
+                snprintf(successText, sizeof(successText), "Install finished.\n%lu title(s) already installed, skipped.", installData->skipped);
+
+                prompt_display_notify("Success", successText, COLOR_TEXT, NULL, NULL, NULL);
+            } else {
+                prompt_display_notify("Success", "Install finished.", COLOR_TEXT, NULL, NULL, NULL);
+            }
         }
 
         action_install_url_free_data(installData);
@@ -274,14 +314,36 @@ static void action_install_url_install_update(ui_view* view, void* data, float*
     }
 
     *progress = installData->installInfo.currTotal != 0 ? (float) ((double) installData->installInfo.currProcessed / (double) installData->installInfo.currTotal) : 0;
-    snprintf(text, PROGRESS_TEXT_MAX, "%lu / %lu\n%.2f %s / %.2f %s\n%.2f %s/s, ETA %s", installData->installInfo.processed, installData->installInfo.total,
+
+    char batchText[64] = "";
+    if(installData->totalSize != 0) {
+        u64 batchProcessed = 0;
+        for(u32 i = 0; i < installData->installInfo.processed && i < installData->installInfo.total; i++) {
+            batchProcessed += installData->sizes[i];
+        }
+
+        // Progress is reported in received bytes, which differ from the manifest sizes when the body is compressed.
+        u32 curr = installData->installInfo.processed;
+        if(curr < installData->installInfo.total && installData->installInfo.currTotal != 0) {
+            batchProcessed += (u64) ((double) installData->sizes[curr] * ((double) installData->installInfo.currProcessed / (double) installData->installInfo.currTotal));
+        }
+
+        snprintf(batchText, sizeof(batchText), "\nBatch: %.2f %s / %.2f %s",
+                 ui_get_display_size(batchProcessed),
+                 ui_get_display_size_units(batchProcessed),
+                 ui_get_display_size(installData->totalSize),
+                 ui_get_display_size_units(installData->totalSize));
+    }
+
+    snprintf(text, PROGRESS_TEXT_MAX, "%lu / %lu\n%.2f %s / %.2f %s\n%.2f %s/s, ETA %s%s", installData->installInfo.processed, installData->installInfo.total,
              ui_get_display_size(installData->installInfo.currProcessed),
              ui_get_display_size_units(installData->installInfo.currProcessed),
              ui_get_display_size(installData->installInfo.currTotal),
              ui_get_display_size_units(installData->installInfo.currTotal),
              ui_get_display_size(installData->installInfo.bytesPerSecond),
              ui_get_display_size_units(installData->installInfo.bytesPerSecond),
-             ui_get_display_eta(installData->installInfo.estimatedRemainingSeconds));
+             ui_get_display_eta(installData->installInfo.estimatedRemainingSeconds),
+             batchText);
 }
 
 static void action_install_url_confirm_onresponse(ui_view* view, void* data, u32 response) {
@@ -301,6 +363,238 @@ static void action_install_url_confirm_onresponse(ui_view* view, void* data, u32
     }
 }
 
+typedef struct {
+    char url[DOWNLOAD_URL_MAX];
+    u64 size;
+    char sha256[65];
+    u64 titleId;
+    u16 titleVersion;
+    u32 rank;
+    u32 order;
+} install_url_manifest_entry;
+
+typedef struct {
+    install_url_data* installData;
+    const char* message;
+
+    volatile bool finished;
+    Result result;
+    Handle cancelEvent;
+} install_url_loading_data;
+
+static bool action_install_url_is_manifest(const char* url) {
+    size_t urlLen = strlen(url);
+    size_t nameLen = strlen(INSTALL_URL_MANIFEST_NAME);
+
+    return urlLen >= nameLen + 1 && url[urlLen - nameLen - 1] == '/' && strcmp(&url[urlLen - nameLen], INSTALL_URL_MANIFEST_NAME) == 0;
+}
+
+static u32 action_install_url_manifest_rank(const char* url) {
+    size_t len = strlen(url);
+
+    if((len >= 4 && strcasecmp(&url[len - 4], ".tik") == 0) || (len >= 5 && strcasecmp(&url[len - 5], ".cetk") == 0)) {
+        return 0;
+    } else if(len >= 4 && strcasecmp(&url[len - 4], ".cia") == 0) {
+        return 1;
+    }
+
+    return 2;
+}
+
+static int action_install_url_manifest_compare(const void* e1, const void* e2) {
+    const install_url_manifest_entry* entry1 = (const install_url_manifest_entry*) e1;
+    const install_url_manifest_entry* entry2 = (const install_url_manifest_entry*) e2;
+
+    // Tickets first, then CIAs by title ID (applications before updates and DLC), then everything else.
+    if(entry1->rank != entry2->rank) {
+        return entry1->rank < entry2->rank ? -1 : 1;
+    }
+
+    if(entry1->rank == 1 && entry1->titleId != entry2->titleId) {
+        return entry1->titleId < entry2->titleId ? -1 : 1;
+    }
+
+    return entry1->order < entry2->order ? -1 : entry1->order > entry2->order ? 1 : 0;
+}
+
+static Result action_install_url_manifest_check_running(void* data) {
+    install_url_loading_data* loadingData = (install_url_loading_data*) data;
+
+    if(task_is_quit_all() || svcWaitSynchronization(loadingData->cancelEvent, 0) == 0) {
+        return R_APP_CANCELLED;
+    }
+
+    return 0;
+}
+
+static Result action_install_url_load_manifest(install_url_loading_data* loadingData) {
+    install_url_data* data = loadingData->installData;
+
+    Result res = 0;
+
+    char baseUrl[DOWNLOAD_URL_MAX];
+    string_copy(baseUrl, data->urls[0], sizeof(baseUrl));
+    baseUrl[strlen(baseUrl) - strlen(INSTALL_URL_MANIFEST_NAME)] = '\0';
+
+    install_url_manifest_entry* entries = (install_url_manifest_entry*) calloc(INSTALL_URLS_MAX, sizeof(install_url_manifest_entry));
+    if(entries != NULL) {
+        json_t* json = NULL;
+        if(R_SUCCEEDED(res = http_download_json_check_running(data->urls[0], &json, INSTALL_URL_MANIFEST_MAX, loadingData, action_install_url_manifest_check_running))) {
+            json_t* files = json_is_object(json) ? json_object_get(json, "files") : NULL;
+            if(json_is_array(files)) {
+                u32 count = 0;
+
+                for(u32 i = 0; i < json_array_size(files) && count < INSTALL_URLS_MAX; i++) {
+                    json_t* file = json_array_get(files, i);
+                    if(!json_is_object(file)) {
+                        continue;
+                    }
+
+                    json_t* url = json_object_get(file, "url");
+                    json_t* size = json_object_get(file, "size");
+                    json_t* sha256 = json_object_get(file, "sha256");
+                    json_t* titleId = json_object_get(file, "titleId");
+                    json_t* titleVersion = json_object_get(file, "titleVersion");
+
+                    if(!json_is_string(url)) {
+                        continue;
+                    }
+
+                    install_url_manifest_entry* entry = &entries[count];
+                    snprintf(entry->url, sizeof(entry->url), "%s%s", baseUrl, json_string_value(url));
+                    entry->size = json_is_integer(size) ? (u64) json_integer_value(size) : 0;
+                    string_copy(entry->sha256, json_is_string(sha256) ? json_string_value(sha256) : "", sizeof(entry->sha256));
+                    entry->titleId = json_is_string(titleId) ? strtoull(json_string_value(titleId), NULL, 16) : 0;
+                    entry->titleVersion = json_is_integer(titleVersion) ? (u16) json_integer_value(titleVersion) : 0;
+                    entry->rank = action_install_url_manifest_rank(entry->url);
+                    entry->order = i;
+
+                    // Drop exact duplicates, and keep only the newest version of a CIA title.
+                    bool duplicate = false;
+                    for(u32 j = 0; j < count && !duplicate; j++) {
+                        install_url_manifest_entry* other = &entries[j];
+
+                        if(!string_is_empty(entry->sha256) && strcmp(entry->sha256, other->sha256) == 0) {
+                            duplicate = true;
+                        } else if(entry->rank == 1 && other->rank == 1 && entry->titleId != 0 && entry->titleId == other->titleId) {
+                            if(entry->titleVersion > other->titleVersion) {
+                                *other = *entry;
+                            }
+
+                            duplicate = true;
+                        }
+                    }
+
+                    if(!duplicate) {
+                        count++;
+                    }
+                }
+
+                if(count == 0) {
+                    res = R_APP_BAD_DATA;
+                }
+
+                qsort(entries, count, sizeof(install_url_manifest_entry), action_install_url_manifest_compare);
+
+                data->installInfo.total = count;
+                data->installInfo.processed = count;
+                data->totalSize = 0;
+
+                for(u32 i = 0; i < count; i++) {
+                    string_copy(data->urls[i], entries[i].url, DOWNLOAD_URL_MAX);
+                    data->sizes[i] = entries[i].size;
+                    data->totalSize += entries[i].size;
+                }
+            } else {
+                res = R_APP_PARSE_FAILED;
+            }
+
+            json_decref(json);
+        }
+
+        free(entries);
+    } else {
+        res = R_APP_OUT_OF_MEMORY;
+    }
+
+    return res;
+}
+
+static void action_install_url_loading_thread(void* arg) {
+    install_url_loading_data* loadingData = (install_url_loading_data*) arg;
+
+    loadingData->result = action_install_url_load_manifest(loadingData);
+
+    svcCloseHandle(loadingData->cancelEvent);
+    loadingData->finished = true;
+}
+
+static void action_install_url_loading_update(ui_view* view, void* data, float* progress, char* text) {
+    install_url_loading_data* loadingData = (install_url_loading_data*) data;
+
+    if(loadingData->finished) {
+        ui_pop();
+        info_destroy(view);
+
+        if(R_SUCCEEDED(loadingData->result)) {
+            prompt_display_yes_no("Confirmation", loadingData->message, COLOR_TEXT, loadingData->installData, action_install_url_draw_top, action_install_url_confirm_onresponse);
+        } else {
+            if(loadingData->result != R_APP_CANCELLED) {
+                error_display_res(NULL, NULL, loadingData->result, "Failed to load install manifest.");
+            }
+
+            action_install_url_free_data(loadingData->installData);
+        }
+
+        free(loadingData);
+        return;
+    }
+
+    if((hidKeysDown() & KEY_B) && !loadingData->finished) {
+        svcSignalEvent(loadingData->cancelEvent);
+    }
+
+    snprintf(text, PROGRESS_TEXT_MAX, "Fetching install manifest...");
+}
+
+static void action_install_url_load_manifest_async(install_url_data* data, const char* message) {
+    install_url_loading_data* loadingData = (install_url_loading_data*) calloc(1, sizeof(install_url_loading_data));
+    if(loadingData == NULL) {
+        error_display(NULL, NULL, "Failed to allocate loading data.");
+
+        action_install_url_free_data(data);
+        return;
+    }
+
+    loadingData->installData = data;
+    loadingData->message = message;
+
+    loadingData->finished = false;
+    loadingData->result = 0;
+    loadingData->cancelEvent = 0;
+
+    Result res = 0;
+    if(R_SUCCEEDED(res = svcCreateEvent(&loadingData->cancelEvent, RESET_STICKY))) {
+        if(threadCreate(action_install_url_loading_thread, loadingData, 0x10000, 0x19, 1, true) == NULL) {
+            res = R_APP_THREAD_CREATE_FAILED;
+        }
+    }
+
+    if(R_FAILED(res)) {
+        if(loadingData->cancelEvent != 0) {
+            svcCloseHandle(loadingData->cancelEvent);
+        }
+
+        error_display_res(NULL, NULL, res, "Failed to initiate install manifest download.");
+
+        free(loadingData);
+        action_install_url_free_data(data);
+        return;
+    }
+
+    info_display("Loading", "Press B to cancel.", false, loadingData, action_install_url_loading_update, NULL);
+}
+
 void action_install_url(const char* confirmMessage, const char* urls, const char* paths, void* userData,
                         void (*finishedURL)(void* data, u32 index),
                         void (*finishedAll)(void* data),
@@ -372,6 +666,8 @@ void action_install_url(const char* confirmMessage, const char* urls, const char
     data->finishedAll = finishedAll;
     data->drawTop = drawTop;
 
+    data->skipped = 0;
+
     data->contentType = CONTENT_CIA;
     data->currTitleId = 0;
     data->n3dsContinue = false;
@@ -399,5 +695,11 @@ void action_install_url(const char* confirmMessage, const char* urls, const char
 
     data->installInfo.finished = true;
 
+    if(data->installInfo.total == 1 && action_install_url_is_manifest(data->urls[0])) {
+        // The manifest is fetched in the background, filling in the URL list before the confirmation prompt.
+        action_install_url_load_manifest_async(data, confirmMessage);
+        return;
+    }
+
     prompt_display_yes_no("Confirmation", confirmMessage, COLOR_TEXT, data, action_install_url_draw_top, action_install_url_confirm_onresponse);
 }
\ No newline at end of file
@@ -418,7 +418,7 @@ void files_open(FS_ArchiveID archiveId, FS_Path archivePath) {
         return;
     }
 
-    list_display("Files", "A: Select, B: Back, X: Refresh, Select: Options", data, files_update, files_draw_top);
+    list_enable_filter(list_display("Files", "A: Select, B: Back, X: Refresh, Y: Filter, Select: Options", data, files_update, files_draw_top), NULL);
 }
 
 static void files_open_nand_warning_onresponse(ui_view* view, void* data, u32 response) {
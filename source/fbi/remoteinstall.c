@@ -13,7 +13,6 @@
 #include "action/action.h"
 #include "task/uitask.h"
 #include "../core/core.h"
-#include "../libs/quirc/quirc_internal.h"
 
 static bool remoteinstall_get_last_urls(char* out, size_t size) {
     if(out == NULL || size == 0) {
@@ -243,14 +242,31 @@ static void remoteinstall_receive_urls_network() {
 #define QR_IMAGE_HEIGHT 240
 
 typedef struct {
-    struct quirc* qrContext;
     u32 tex;
+    u32 texFrame;
 
     bool capturing;
     capture_cam_data captureInfo;
+
+    bool scanning;
+    scan_qr_data scanInfo;
 } remoteinstall_qr_data;
 
+static void remoteinstall_qr_stop_scan(remoteinstall_qr_data* data) {
+    if(!data->scanInfo.finished) {
+        svcSignalEvent(data->scanInfo.cancelEvent);
+        while(!data->scanInfo.finished) {
+            svcSleepThread(1000000);
+        }
+    }
+
+    data->scanning = false;
+}
+
 static void remoteinstall_qr_stop_capture(remoteinstall_qr_data* data) {
+    // The scan task reads from the capture buffer, so it has to stop first.
+    remoteinstall_qr_stop_scan(data);
+
     if(!data->captureInfo.finished) {
         svcSignalEvent(data->captureInfo.cancelEvent);
         while(!data->captureInfo.finished) {
@@ -258,11 +274,11 @@ static void remoteinstall_qr_stop_capture(remoteinstall_qr_data* data) {
         }
     }
 
+    task_capture_cam_close(&data->captureInfo);
+
     data->capturing = false;
 
-    if(data->captureInfo.buffer != NULL) {
-        memset(data->captureInfo.buffer, 0, QR_IMAGE_WIDTH * QR_IMAGE_HEIGHT * sizeof(u16));
-    }
+    data->texFrame = 0;
 }
 
 static void remoteinstall_qr_free_data(remoteinstall_qr_data* data) {
@@ -273,34 +289,49 @@ static void remoteinstall_qr_free_data(remoteinstall_qr_data* data) {
         data->captureInfo.buffer = NULL;
     }
 
+    if(data->scanInfo.payload != NULL) {
+        free(data->scanInfo.payload);
+        data->scanInfo.payload = NULL;
+    }
+
     if(data->tex != 0) {
         screen_unload_texture(data->tex);
         data->tex = 0;
     }
 
-    if(data->qrContext != NULL) {
-        quirc_destroy(data->qrContext);
-        data->qrContext = NULL;
-    }
-
     free(data);
 }
 
 static void remoteinstall_qr_draw_top(ui_view* view, void* data, float x1, float y1, float x2, float y2) {
     remoteinstall_qr_data* installData = (remoteinstall_qr_data*) data;
 
-    if(installData->tex != 0) {
-        svcWaitSynchronization(installData->captureInfo.mutex, U64_MAX);
-        screen_load_texture_untiled(installData->tex, installData->captureInfo.buffer, QR_IMAGE_WIDTH * QR_IMAGE_HEIGHT * sizeof(u16), QR_IMAGE_WIDTH, QR_IMAGE_HEIGHT, GPU_RGB565, false);
-        svcReleaseMutex(installData->captureInfo.mutex);
+    if(installData->tex != 0 && !installData->captureInfo.finished) {
+        // Only upload frames that have not been shown yet.
+        u32 frame = 0;
+        const u16* buffer = task_capture_cam_acquire(&installData->captureInfo, &frame);
+        if(buffer != NULL) {
+            if(frame != installData->texFrame) {
+                screen_load_texture_untiled(installData->tex, (void*) buffer, QR_IMAGE_WIDTH * QR_IMAGE_HEIGHT * sizeof(u16), QR_IMAGE_WIDTH, QR_IMAGE_HEIGHT, GPU_RGB565, false);
+                installData->texFrame = frame;
+            }
+
+            task_capture_cam_release(&installData->captureInfo, buffer);
+        }
 
-        screen_draw_texture(installData->tex, 0, 0, QR_IMAGE_WIDTH, QR_IMAGE_HEIGHT);
+        if(installData->texFrame != 0) {
+            screen_draw_texture(installData->tex, 0, 0, QR_IMAGE_WIDTH, QR_IMAGE_HEIGHT);
+        }
     }
 }
 
 static void remoteinstall_qr_update(ui_view* view, void* data, float* progress, char* text) {
     remoteinstall_qr_data* installData = (remoteinstall_qr_data*) data;
 
+    // New camera frames change the top screen without any other state changing.
+    if(installData->capturing && installData->captureInfo.frameCount != installData->texFrame) {
+        ui_invalidate();
+    }
+
     if(hidKeysDown() & KEY_B) {
         ui_pop();
         info_destroy(view);
@@ -346,42 +377,47 @@ static void remoteinstall_qr_update(ui_view* view, void* data, float* progress,
         return;
     }
 
-    int w = 0;
-    int h = 0;
-    uint8_t* qrBuf = quirc_begin(installData->qrContext, &w, &h);
+    if(!installData->scanning) {
+        Result scanRes = task_scan_qr(&installData->scanInfo);
+        if(R_FAILED(scanRes)) {
+            ui_pop();
+            info_destroy(view);
 
-    svcWaitSynchronization(installData->captureInfo.mutex, U64_MAX);
+            error_display_res(NULL, NULL, scanRes, "Failed to start QR code scanning.");
 
-    for(int x = 0; x < w; x++) {
-        for(int y = 0; y < h; y++) {
-            u16 px = installData->captureInfo.buffer[y * QR_IMAGE_WIDTH + x];
-            qrBuf[y * w + x] = (u8) (((((px >> 11) & 0x1F) << 3) + (((px >> 5) & 0x3F) << 2) + ((px & 0x1F) << 3)) / 3);
+            remoteinstall_qr_free_data(installData);
+            return;
+        } else {
+            installData->scanning = true;
         }
     }
 
-    svcReleaseMutex(installData->captureInfo.mutex);
-
-    quirc_end(installData->qrContext);
-
-    int qrCount = quirc_count(installData->qrContext);
-    for(int i = 0; i < qrCount; i++) {
-        struct quirc_code qrCode;
-        quirc_extract(installData->qrContext, i, &qrCode);
+    if(installData->scanInfo.finished) {
+        if(installData->scanInfo.found) {
+            remoteinstall_qr_stop_capture(installData);
 
-        struct quirc_data qrData;
-        quirc_decode_error_t err = quirc_decode(&qrCode, &qrData);
+            remoteinstall_set_last_urls(installData->scanInfo.payload);
 
-        if(err == 0) {
-            remoteinstall_qr_stop_capture(installData);
+            action_install_url("Install from the scanned QR code?", installData->scanInfo.payload, NULL, NULL, NULL, NULL, NULL);
+            return;
+        } else if(R_FAILED(installData->scanInfo.result)) {
+            ui_pop();
+            info_destroy(view);
 
-            remoteinstall_set_last_urls((const char*) qrData.payload);
+            error_display_res(NULL, NULL, installData->scanInfo.result, "Error while scanning for QR codes.");
 
-            action_install_url("Install from the scanned QR code?", (const char*) qrData.payload, NULL, NULL, NULL, NULL, NULL);
+            remoteinstall_qr_free_data(installData);
             return;
         }
+
+        installData->scanning = false;
     }
 
-    snprintf(text, PROGRESS_TEXT_MAX, "Waiting for QR code...");
+    if(installData->scanInfo.partsTotal > 0) {
+        snprintf(text, PROGRESS_TEXT_MAX, "Scanning QR code sequence...\n%lu of %lu codes scanned", installData->scanInfo.partsFound, installData->scanInfo.partsTotal);
+    } else {
+        snprintf(text, PROGRESS_TEXT_MAX, "Waiting for QR code...");
+    }
 }
 
 static void remoteinstall_scan_qr_code() {
@@ -393,8 +429,10 @@ static void remoteinstall_scan_qr_code() {
     }
 
     data->tex = 0;
+    data->texFrame = 0;
 
     data->capturing = false;
+    data->scanning = false;
 
     data->captureInfo.width = QR_IMAGE_WIDTH;
     data->captureInfo.height = QR_IMAGE_HEIGHT;
@@ -403,22 +441,10 @@ static void remoteinstall_scan_qr_code() {
 
     data->captureInfo.finished = true;
 
-    data->qrContext = quirc_new();
-    if(data->qrContext == NULL) {
-        error_display(NULL, NULL, "Failed to create QR context.");
-
-        remoteinstall_qr_free_data(data);
-        return;
-    }
-
-    if(quirc_resize(data->qrContext, QR_IMAGE_WIDTH, QR_IMAGE_HEIGHT) != 0) {
-        error_display(NULL, NULL, "Failed to resize QR context.");
-
-        remoteinstall_qr_free_data(data);
-        return;
-    }
+    data->scanInfo.capture = &data->captureInfo;
+    data->scanInfo.finished = true;
 
-    data->captureInfo.buffer = (u16*) calloc(1, QR_IMAGE_WIDTH * QR_IMAGE_HEIGHT * sizeof(u16));
+    data->captureInfo.buffer = (u16*) calloc(CAPTURE_CAM_BUFFER_COUNT, QR_IMAGE_WIDTH * QR_IMAGE_HEIGHT * sizeof(u16));
     if(data->captureInfo.buffer == NULL) {
         error_display(NULL, NULL, "Failed to create image buffer.");
 
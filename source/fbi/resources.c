@@ -1,6 +1,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include <3ds.h>
 
@@ -29,11 +30,225 @@ static void resources_load_texture(u32 id, const char* name) {
         return;
     }
 
-    screen_load_texture_file(id, fd, true);
+    screen_load_texture_file_atlas(id, fd, true);
 
     fclose(fd);
 }
 
+static const struct {
+    u32 id;
+    const char* name;
+} resources_textures[] = {
+    {TEXTURE_BOTTOM_SCREEN_BG, "bottom_screen_bg.png"},
+    {TEXTURE_BOTTOM_SCREEN_TOP_BAR, "bottom_screen_top_bar.png"},
+    {TEXTURE_BOTTOM_SCREEN_TOP_BAR_SHADOW, "bottom_screen_top_bar_shadow.png"},
+    {TEXTURE_BOTTOM_SCREEN_BOTTOM_BAR, "bottom_screen_bottom_bar.png"},
+    {TEXTURE_BOTTOM_SCREEN_BOTTOM_BAR_SHADOW, "bottom_screen_bottom_bar_shadow.png"},
+    {TEXTURE_TOP_SCREEN_BG, "top_screen_bg.png"},
+    {TEXTURE_TOP_SCREEN_TOP_BAR, "top_screen_top_bar.png"},
+    {TEXTURE_TOP_SCREEN_TOP_BAR_SHADOW, "top_screen_top_bar_shadow.png"},
+    {TEXTURE_TOP_SCREEN_BOTTOM_BAR, "top_screen_bottom_bar.png"},
+    {TEXTURE_TOP_SCREEN_BOTTOM_BAR_SHADOW, "top_screen_bottom_bar_shadow.png"},
+    {TEXTURE_LOGO, "logo.png"},
+    {TEXTURE_SELECTION_OVERLAY, "selection_overlay.png"},
+    {TEXTURE_SCROLL_BAR, "scroll_bar.png"},
+    {TEXTURE_BUTTON, "button.png"},
+    {TEXTURE_PROGRESS_BAR_BG, "progress_bar_bg.png"},
+    {TEXTURE_PROGRESS_BAR_CONTENT, "progress_bar_content.png"},
+    {TEXTURE_META_INFO_BOX, "meta_info_box.png"},
+    {TEXTURE_META_INFO_BOX_SHADOW, "meta_info_box_shadow.png"},
+    {TEXTURE_BATTERY_CHARGING, "battery_charging.png"},
+    {TEXTURE_BATTERY_0, "battery0.png"},
+    {TEXTURE_BATTERY_1, "battery1.png"},
+    {TEXTURE_BATTERY_2, "battery2.png"},
+    {TEXTURE_BATTERY_3, "battery3.png"},
+    {TEXTURE_BATTERY_4, "battery4.png"},
+    {TEXTURE_BATTERY_5, "battery5.png"},
+    {TEXTURE_WIFI_DISCONNECTED, "wifi_disconnected.png"},
+    {TEXTURE_WIFI_0, "wifi0.png"},
+    {TEXTURE_WIFI_1, "wifi1.png"},
+    {TEXTURE_WIFI_2, "wifi2.png"},
+    {TEXTURE_WIFI_3, "wifi3.png"},
+};
+
+#define RESOURCES_TEXTURE_COUNT (sizeof(resources_textures) / sizeof(resources_textures[0]))
+
+#define RESOURCES_CACHE_PATH "sdmc:/fbi/theme.cache"
+#define RESOURCES_CACHE_MAGIC 0x43544246 // "FBTC"
+#define RESOURCES_CACHE_VERSION 3
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    u32 stamp;
+    u32 hash;
+} resources_cache_header;
+
+static u32 resources_fnv(u32 hash, const void* data, size_t size) {
+    for(size_t i = 0; i < size; i++) {
+        hash = (hash ^ ((const u8*) data)[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+// Cheap fingerprint of the theme from file metadata alone. RomFS images are tied to the build, so the version
+// stands in for their modification time.
+static u32 resources_stamp_textures() {
+    char version[16];
+    snprintf(version, sizeof(version), "%d.%d.%d", VERSION_MAJOR, VERSION_MINOR, VERSION_MICRO);
+
+    u32 stamp = resources_fnv(2166136261u, version, strlen(version));
+
+    for(u32 i = 0; i < RESOURCES_TEXTURE_COUNT; i++) {
+        char realPath[FILE_PATH_MAX];
+        snprintf(realPath, sizeof(realPath), "sdmc:/fbi/theme/%s", resources_textures[i].name);
+
+        struct stat st;
+        u8 source = 1;
+        if(stat(realPath, &st) != 0) {
+            snprintf(realPath, sizeof(realPath), "romfs:/%s", resources_textures[i].name);
+
+            source = 0;
+            if(stat(realPath, &st) != 0) {
+                return 0;
+            }
+        }
+
+        u64 size = (u64) st.st_size;
+        u64 mtime = (u64) st.st_mtime;
+
+        stamp = resources_fnv(stamp, &source, sizeof(source));
+        stamp = resources_fnv(stamp, &size, sizeof(size));
+        stamp = resources_fnv(stamp, &mtime, sizeof(mtime));
+    }
+
+    return stamp;
+}
+
+// Hashes the contents of every theme image, so that changing, adding or removing one invalidates the cache.
+// Only needed when the stamp no longer matches.
+static u32 resources_hash_textures() {
+    u32 hash = 2166136261u;
+
+    u8 buffer[4096];
+    for(u32 i = 0; i < RESOURCES_TEXTURE_COUNT; i++) {
+        FILE* fd = resources_open_file(resources_textures[i].name);
+        if(fd == NULL) {
+            return 0;
+        }
+
+        size_t bytesRead = 0;
+        while((bytesRead = fread(buffer, 1, sizeof(buffer), fd)) > 0) {
+            hash = resources_fnv(hash, buffer, bytesRead);
+        }
+
+        fclose(fd);
+
+        hash = (hash ^ 0xFF) * 16777619u;
+    }
+
+    return hash;
+}
+
+// On a stamp mismatch the contents are hashed; if they are unchanged, the cache is used and restamped.
+static bool resources_read_cache(u32* ids, u32 stamp, u32* hashOut) {
+    FILE* fd = fopen(RESOURCES_CACHE_PATH, "r+b");
+    if(fd == NULL) {
+        return false;
+    }
+
+    resources_cache_header header;
+    bool success = fread(&header, sizeof(header), 1, fd) == 1
+                   && header.magic == RESOURCES_CACHE_MAGIC
+                   && header.version == RESOURCES_CACHE_VERSION;
+
+    bool restamp = false;
+    if(success && header.stamp != stamp) {
+        *hashOut = resources_hash_textures();
+
+        success = *hashOut != 0 && header.hash == *hashOut;
+        restamp = true;
+    }
+
+    success = success && screen_read_texture_cache(fd, ids, RESOURCES_TEXTURE_COUNT);
+
+    if(success && restamp) {
+        header.stamp = stamp;
+
+        fseek(fd, 0, SEEK_SET);
+        fwrite(&header, sizeof(header), 1, fd);
+    }
+
+    fclose(fd);
+    return success;
+}
+
+static void resources_write_cache(u32* ids, u32 stamp, u32 hash) {
+    FS_Archive sdmcArchive = 0;
+    if(R_FAILED(FSUSER_OpenArchive(&sdmcArchive, ARCHIVE_SDMC, fsMakePath(PATH_EMPTY, "")))) {
+        return;
+    }
+
+    Result res = fs_ensure_dir(sdmcArchive, "/fbi/");
+    FSUSER_CloseArchive(sdmcArchive);
+
+    if(R_FAILED(res)) {
+        return;
+    }
+
+    FILE* fd = fopen(RESOURCES_CACHE_PATH, "wb");
+    if(fd == NULL) {
+        return;
+    }
+
+    resources_cache_header header;
+    header.magic = RESOURCES_CACHE_MAGIC;
+    header.version = RESOURCES_CACHE_VERSION;
+    header.stamp = stamp;
+    header.hash = hash;
+
+    bool success = fwrite(&header, sizeof(header), 1, fd) == 1 && screen_write_texture_cache(fd, ids, RESOURCES_TEXTURE_COUNT);
+
+    if(fclose(fd) != 0 || !success) {
+        remove(RESOURCES_CACHE_PATH);
+    }
+}
+
+// Images are only decoded when the theme has changed since the cache was written.
+static void resources_load_textures() {
+    u32 ids[RESOURCES_TEXTURE_COUNT];
+    for(u32 i = 0; i < RESOURCES_TEXTURE_COUNT; i++) {
+        ids[i] = resources_textures[i].id;
+    }
+
+    u32 stamp = resources_stamp_textures();
+    if(stamp == 0) {
+        for(u32 i = 0; i < RESOURCES_TEXTURE_COUNT; i++) {
+            resources_load_texture(resources_textures[i].id, resources_textures[i].name);
+        }
+
+        return;
+    }
+
+    u32 hash = 0;
+    if(resources_read_cache(ids, stamp, &hash)) {
+        return;
+    }
+
+    for(u32 i = 0; i < RESOURCES_TEXTURE_COUNT; i++) {
+        resources_load_texture(resources_textures[i].id, resources_textures[i].name);
+    }
+
+    if(hash == 0) {
+        hash = resources_hash_textures();
+    }
+
+    if(hash != 0) {
+        resources_write_cache(ids, stamp, hash);
+    }
+}
+
 void resources_load() {
     FILE* fd = resources_open_file("textcolor.cfg");
     if(fd == NULL) {
@@ -75,34 +290,5 @@ void resources_load() {
 
     fclose(fd);
 
-    resources_load_texture(TEXTURE_BOTTOM_SCREEN_BG, "bottom_screen_bg.png");
-    resources_load_texture(TEXTURE_BOTTOM_SCREEN_TOP_BAR, "bottom_screen_top_bar.png");
-    resources_load_texture(TEXTURE_BOTTOM_SCREEN_TOP_BAR_SHADOW, "bottom_screen_top_bar_shadow.png");
-    resources_load_texture(TEXTURE_BOTTOM_SCREEN_BOTTOM_BAR, "bottom_screen_bottom_bar.png");
-    resources_load_texture(TEXTURE_BOTTOM_SCREEN_BOTTOM_BAR_SHADOW, "bottom_screen_bottom_bar_shadow.png");
-    resources_load_texture(TEXTURE_TOP_SCREEN_BG, "top_screen_bg.png");
-    resources_load_texture(TEXTURE_TOP_SCREEN_TOP_BAR, "top_screen_top_bar.png");
-    resources_load_texture(TEXTURE_TOP_SCREEN_TOP_BAR_SHADOW, "top_screen_top_bar_shadow.png");
-    resources_load_texture(TEXTURE_TOP_SCREEN_BOTTOM_BAR, "top_screen_bottom_bar.png");
-    resources_load_texture(TEXTURE_TOP_SCREEN_BOTTOM_BAR_SHADOW, "top_screen_bottom_bar_shadow.png");
-    resources_load_texture(TEXTURE_LOGO, "logo.png");
-    resources_load_texture(TEXTURE_SELECTION_OVERLAY, "selection_overlay.png");
-    resources_load_texture(TEXTURE_SCROLL_BAR, "scroll_bar.png");
-    resources_load_texture(TEXTURE_BUTTON, "button.png");
-    resources_load_texture(TEXTURE_PROGRESS_BAR_BG, "progress_bar_bg.png");
-    resources_load_texture(TEXTURE_PROGRESS_BAR_CONTENT, "progress_bar_content.png");
-    resources_load_texture(TEXTURE_META_INFO_BOX, "meta_info_box.png");
-    resources_load_texture(TEXTURE_META_INFO_BOX_SHADOW, "meta_info_box_shadow.png");
-    resources_load_texture(TEXTURE_BATTERY_CHARGING, "battery_charging.png");
-    resources_load_texture(TEXTURE_BATTERY_0, "battery0.png");
-    resources_load_texture(TEXTURE_BATTERY_1, "battery1.png");
-    resources_load_texture(TEXTURE_BATTERY_2, "battery2.png");
-    resources_load_texture(TEXTURE_BATTERY_3, "battery3.png");
-    resources_load_texture(TEXTURE_BATTERY_4, "battery4.png");
-    resources_load_texture(TEXTURE_BATTERY_5, "battery5.png");
-    resources_load_texture(TEXTURE_WIFI_DISCONNECTED, "wifi_disconnected.png");
-    resources_load_texture(TEXTURE_WIFI_0, "wifi0.png");
-    resources_load_texture(TEXTURE_WIFI_1, "wifi1.png");
-    resources_load_texture(TEXTURE_WIFI_2, "wifi2.png");
-    resources_load_texture(TEXTURE_WIFI_3, "wifi3.png");
+    resources_load_textures();
 }
\ No newline at end of file
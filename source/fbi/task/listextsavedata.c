@@ -12,6 +12,11 @@
 
 #define MAX_EXT_SAVE_DATA 512
 
+// Minimum number of ext save data entries gathered before they are sorted and merged into the visible list.
+// Later batches wait until they are at least as large as the list, so each merge walk is paid for by the batch
+// it inserts and populating stays O(n log n) while the first entries still show up early.
+#define EXT_SAVE_DATA_MERGE_BATCH 32
+
 static int task_populate_ext_save_data_compare_ids(const void* e1, const void* e2) {
     u64 id1 = *(u64*) e1;
     u64 id2 = *(u64*) e2;
@@ -22,6 +27,9 @@ static int task_populate_ext_save_data_compare_ids(const void* e1, const void* e
 static Result task_populate_ext_save_data_from(populate_ext_save_data_data* data, FS_MediaType mediaType) {
     Result res = 0;
 
+    linked_list staged;
+    linked_list_init(&staged);
+
     u32 extSaveDataCount = 0;
     u64 extSaveDataIds[MAX_EXT_SAVE_DATA];
     if(R_SUCCEEDED(res = FSUSER_EnumerateExtSaveData(&extSaveDataCount, MAX_EXT_SAVE_DATA, mediaType, 8, mediaType == MEDIATYPE_NAND, (u8*) extSaveDataIds))) {
@@ -79,7 +87,11 @@ static Result task_populate_ext_save_data_from(populate_ext_save_data_data* data
 
                         item->data = extSaveDataInfo;
 
-                        linked_list_add_sorted(data->items, item, data->userData, data->compare);
+                        linked_list_add(&staged, item);
+
+                        if(linked_list_size(&staged) >= EXT_SAVE_DATA_MERGE_BATCH && linked_list_size(&staged) >= linked_list_size(data->items)) {
+                            linked_list_merge_sorted(data->items, &staged, data->userData, data->compare);
+                        }
                     } else {
                         free(item);
 
@@ -92,6 +104,9 @@ static Result task_populate_ext_save_data_from(populate_ext_save_data_data* data
         }
     }
 
+    linked_list_merge_sorted(data->items, &staged, data->userData, data->compare);
+    linked_list_destroy(&staged);
+
     return res;
 }
 
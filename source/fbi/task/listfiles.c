@@ -293,6 +293,9 @@ static void task_populate_files_thread(void* arg) {
             file_info* fileInfo = (file_info*) item->data;
 
             task_populate_files_retrieve_meta(fileInfo);
+
+            // The item may already be selected, with its icon and details on the top screen.
+            ui_invalidate();
         }
     }
 
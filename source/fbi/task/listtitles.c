@@ -10,7 +10,12 @@
 #include "../resources.h"
 #include "../../core/core.h"
 
-static Result task_populate_titles_add_ctr(populate_titles_data* data, FS_MediaType mediaType, u64 titleId) {
+// Minimum number of titles gathered before they are sorted and merged into the visible list. Later batches
+// wait until they are at least as large as the list, so each merge walk is paid for by the batch it inserts
+// and populating stays O(n log n) while the first entries still show up early.
+#define TITLES_MERGE_BATCH 32
+
+static Result task_populate_titles_add_ctr(populate_titles_data* data, linked_list* staged, FS_MediaType mediaType, u64 titleId) {
     Result res = 0;
 
     AM_TitleEntry entry;
@@ -74,7 +79,7 @@ static Result task_populate_titles_add_ctr(populate_titles_data* data, FS_MediaT
 
                 item->data = titleInfo;
 
-                linked_list_add_sorted(data->items, item, data->userData, data->compare);
+                linked_list_add(staged, item);
             } else {
                 free(item);
 
@@ -88,7 +93,7 @@ static Result task_populate_titles_add_ctr(populate_titles_data* data, FS_MediaT
     return res;
 }
 
-static Result task_populate_titles_add_twl(populate_titles_data* data, FS_MediaType mediaType, u64 titleId) {
+static Result task_populate_titles_add_twl(populate_titles_data* data, linked_list* staged, FS_MediaType mediaType, u64 titleId) {
     Result res = 0;
 
     u64 realTitleId = 0;
@@ -209,7 +214,7 @@ static Result task_populate_titles_add_twl(populate_titles_data* data, FS_MediaT
                 item->color = COLOR_DS_TITLE;
                 item->data = titleInfo;
 
-                linked_list_add_sorted(data->items, item, data->userData, data->compare);
+                linked_list_add(staged, item);
             } else {
                 free(item);
 
@@ -239,6 +244,9 @@ static Result task_populate_titles_from(populate_titles_data* data, FS_MediaType
 
     Result res = 0;
 
+    linked_list staged;
+    linked_list_init(&staged);
+
     if(mediaType != MEDIATYPE_GAME_CARD || type == CARD_CTR) {
         u32 titleCount = 0;
         if(R_SUCCEEDED(res = AM_GetTitleCount(mediaType, &titleCount))) {
@@ -259,7 +267,11 @@ static Result task_populate_titles_from(populate_titles_data* data, FS_MediaType
                                 continue;
                             }
 
-                            res = dsiWare ? task_populate_titles_add_twl(data, mediaType, titleIds[i]) : task_populate_titles_add_ctr(data, mediaType, titleIds[i]);
+                            res = dsiWare ? task_populate_titles_add_twl(data, &staged, mediaType, titleIds[i]) : task_populate_titles_add_ctr(data, &staged, mediaType, titleIds[i]);
+
+                            if(linked_list_size(&staged) >= TITLES_MERGE_BATCH && linked_list_size(&staged) >= linked_list_size(data->items)) {
+                                linked_list_merge_sorted(data->items, &staged, data->userData, data->compare);
+                            }
                         }
                     }
                 }
@@ -270,9 +282,12 @@ static Result task_populate_titles_from(populate_titles_data* data, FS_MediaType
             }
         }
     } else {
-        res = task_populate_titles_add_twl(data, mediaType, 0);
+        res = task_populate_titles_add_twl(data, &staged, mediaType, 0);
     }
 
+    linked_list_merge_sorted(data->items, &staged, data->userData, data->compare);
+    linked_list_destroy(&staged);
+
     return res;
 }
 
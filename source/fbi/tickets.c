@@ -137,5 +137,5 @@ void tickets_open() {
 
     data->populateData.finished = true;
 
-    list_display("Tickets", "A: Select, B: Return, X: Refresh", data, tickets_update, tickets_draw_top);
+    list_enable_filter(list_display("Tickets", "A: Select, B: Return, X: Refresh, Y: Filter", data, tickets_update, tickets_draw_top), NULL);
 }
\ No newline at end of file
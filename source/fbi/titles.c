@@ -309,6 +309,12 @@ static int titles_compare(void* data, const void* p1, const void* p2) {
     }
 }
 
+static void titles_search_text(list_item* item, char* text, size_t size) {
+    title_info* info = (title_info*) item->data;
+
+    snprintf(text, size, "%016llX %s", info->titleId, info->productCode);
+}
+
 void titles_open() {
     titles_data* data = (titles_data*) calloc(1, sizeof(titles_data));
     if(data == NULL) {
@@ -330,5 +336,5 @@ void titles_open() {
     data->sortByName = true;
     data->sortBySize = false;
 
-    list_display("Titles", "A: Select, B: Return, X: Refresh, Select: Options", data, titles_update, titles_draw_top);
+    list_enable_filter(list_display("Titles", "A: Select, B: Return, X: Refresh, Y: Filter, Select: Options", data, titles_update, titles_draw_top), titles_search_text);
 }
\ No newline at end of file
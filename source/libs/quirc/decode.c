@@ -47,7 +47,10 @@ static const struct galois_field gf16 = {
 	.exp = gf16_exp
 };
 
-static const uint8_t gf256_exp[256] = {
+/* Two periods of the exponent table, so that the sum of two logarithms
+ * can be used as an index without reducing it modulo 255.
+ */
+static const uint8_t gf256_exp[512] = {
 	0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
 	0x1d, 0x3a, 0x74, 0xe8, 0xcd, 0x87, 0x13, 0x26,
 	0x4c, 0x98, 0x2d, 0x5a, 0xb4, 0x75, 0xea, 0xc9,
@@ -79,7 +82,39 @@ static const uint8_t gf256_exp[256] = {
 	0x12, 0x24, 0x48, 0x90, 0x3d, 0x7a, 0xf4, 0xf5,
 	0xf7, 0xf3, 0xfb, 0xeb, 0xcb, 0x8b, 0x0b, 0x16,
 	0x2c, 0x58, 0xb0, 0x7d, 0xfa, 0xe9, 0xcf, 0x83,
-	0x1b, 0x36, 0x6c, 0xd8, 0xad, 0x47, 0x8e, 0x01
+	0x1b, 0x36, 0x6c, 0xd8, 0xad, 0x47, 0x8e, 0x01,
+	0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1d,
+	0x3a, 0x74, 0xe8, 0xcd, 0x87, 0x13, 0x26, 0x4c,
+	0x98, 0x2d, 0x5a, 0xb4, 0x75, 0xea, 0xc9, 0x8f,
+	0x03, 0x06, 0x0c, 0x18, 0x30, 0x60, 0xc0, 0x9d,
+	0x27, 0x4e, 0x9c, 0x25, 0x4a, 0x94, 0x35, 0x6a,
+	0xd4, 0xb5, 0x77, 0xee, 0xc1, 0x9f, 0x23, 0x46,
+	0x8c, 0x05, 0x0a, 0x14, 0x28, 0x50, 0xa0, 0x5d,
+	0xba, 0x69, 0xd2, 0xb9, 0x6f, 0xde, 0xa1, 0x5f,
+	0xbe, 0x61, 0xc2, 0x99, 0x2f, 0x5e, 0xbc, 0x65,
+	0xca, 0x89, 0x0f, 0x1e, 0x3c, 0x78, 0xf0, 0xfd,
+	0xe7, 0xd3, 0xbb, 0x6b, 0xd6, 0xb1, 0x7f, 0xfe,
+	0xe1, 0xdf, 0xa3, 0x5b, 0xb6, 0x71, 0xe2, 0xd9,
+	0xaf, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0x0d,
+	0x1a, 0x34, 0x68, 0xd0, 0xbd, 0x67, 0xce, 0x81,
+	0x1f, 0x3e, 0x7c, 0xf8, 0xed, 0xc7, 0x93, 0x3b,
+	0x76, 0xec, 0xc5, 0x97, 0x33, 0x66, 0xcc, 0x85,
+	0x17, 0x2e, 0x5c, 0xb8, 0x6d, 0xda, 0xa9, 0x4f,
+	0x9e, 0x21, 0x42, 0x84, 0x15, 0x2a, 0x54, 0xa8,
+	0x4d, 0x9a, 0x29, 0x52, 0xa4, 0x55, 0xaa, 0x49,
+	0x92, 0x39, 0x72, 0xe4, 0xd5, 0xb7, 0x73, 0xe6,
+	0xd1, 0xbf, 0x63, 0xc6, 0x91, 0x3f, 0x7e, 0xfc,
+	0xe5, 0xd7, 0xb3, 0x7b, 0xf6, 0xf1, 0xff, 0xe3,
+	0xdb, 0xab, 0x4b, 0x96, 0x31, 0x62, 0xc4, 0x95,
+	0x37, 0x6e, 0xdc, 0xa5, 0x57, 0xae, 0x41, 0x82,
+	0x19, 0x32, 0x64, 0xc8, 0x8d, 0x07, 0x0e, 0x1c,
+	0x38, 0x70, 0xe0, 0xdd, 0xa7, 0x53, 0xa6, 0x51,
+	0xa2, 0x59, 0xb2, 0x79, 0xf2, 0xf9, 0xef, 0xc3,
+	0x9b, 0x2b, 0x56, 0xac, 0x45, 0x8a, 0x09, 0x12,
+	0x24, 0x48, 0x90, 0x3d, 0x7a, 0xf4, 0xf5, 0xf7,
+	0xf3, 0xfb, 0xeb, 0xcb, 0x8b, 0x0b, 0x16, 0x2c,
+	0x58, 0xb0, 0x7d, 0xfa, 0xe9, 0xcf, 0x83, 0x1b,
+	0x36, 0x6c, 0xd8, 0xad, 0x47, 0x8e, 0x01, 0x02
 };
 
 static const uint8_t gf256_log[256] = {
@@ -149,6 +184,31 @@ static void poly_add(uint8_t *dst, const uint8_t *src, uint8_t c,
 	}
 }
 
+/* poly_add specialized for GF(2^8). Logarithms are at most 255, so the
+ * sum of two indexes the doubled exponent table without reduction.
+ */
+static void poly_add_gf256(uint8_t *dst, const uint8_t *src, uint8_t c,
+			   int shift)
+{
+	int i;
+	int log_c = gf256_log[c];
+
+	if (!c)
+		return;
+
+	for (i = 0; i < MAX_POLY; i++) {
+		int p = i + shift;
+		uint8_t v = src[i];
+
+		if (p < 0 || p >= MAX_POLY)
+			continue;
+		if (!v)
+			continue;
+
+		dst[p] ^= gf256_exp[gf256_log[v] + log_c];
+	}
+}
+
 static uint8_t poly_eval(const uint8_t *s, uint8_t x,
 			 const struct galois_field *gf)
 {
@@ -171,6 +231,33 @@ static uint8_t poly_eval(const uint8_t *s, uint8_t x,
 	return sum;
 }
 
+/* Polynomial evaluation specialized for GF(2^8), stepping the exponent
+ * of x instead of reducing log_x * i for every term.
+ */
+static uint8_t poly_eval_gf256(const uint8_t *s, uint8_t x)
+{
+	int i;
+	int k = 0;
+	uint8_t sum = 0;
+	uint8_t log_x = gf256_log[x];
+
+	if (!x)
+		return s[0];
+
+	for (i = 0; i < MAX_POLY; i++) {
+		uint8_t c = s[i];
+
+		if (c)
+			sum ^= gf256_exp[gf256_log[c] + k];
+
+		k += log_x;
+		if (k >= 255)
+			k -= 255;
+	}
+
+	return sum;
+}
+
 /************************************************************************
  * Berlekamp-Massey algorithm for finding error locator polynomials.
  */
@@ -227,6 +314,61 @@ static void berlekamp_massey(const uint8_t *s, int N,
 	memcpy(sigma, C, MAX_POLY);
 }
 
+/* berlekamp_massey specialized for GF(2^8), used for every data block.
+ * b is never zero, so 255 - log(b) + log(d) stays within the doubled
+ * exponent table.
+ */
+static void berlekamp_massey_gf256(const uint8_t *s, int N, uint8_t *sigma)
+{
+	uint8_t C[MAX_POLY];
+	uint8_t B[MAX_POLY];
+	int L = 0;
+	int m = 1;
+	uint8_t b = 1;
+	int n;
+
+	memset(B, 0, sizeof(B));
+	memset(C, 0, sizeof(C));
+	B[0] = 1;
+	C[0] = 1;
+
+	for (n = 0; n < N; n++) {
+		uint8_t d = s[n];
+		uint8_t mult;
+		int i;
+
+		for (i = 1; i <= L; i++) {
+			if (!(C[i] && s[n - i]))
+				continue;
+
+			d ^= gf256_exp[gf256_log[C[i]] + gf256_log[s[n - i]]];
+		}
+
+		if (!d) {
+			m++;
+			continue;
+		}
+
+		mult = gf256_exp[255 - gf256_log[b] + gf256_log[d]];
+
+		if (L * 2 <= n) {
+			uint8_t T[MAX_POLY];
+
+			memcpy(T, C, sizeof(T));
+			poly_add_gf256(C, B, mult, m);
+			memcpy(B, T, sizeof(B));
+			L = n + 1 - L;
+			b = d;
+			m = 1;
+		} else {
+			poly_add_gf256(C, B, mult, m);
+			m++;
+		}
+	}
+
+	memcpy(sigma, C, MAX_POLY);
+}
+
 /************************************************************************
  * Code stream error correction
  *
@@ -237,25 +379,35 @@ static int block_syndromes(const uint8_t *data, int bs, int npar, uint8_t *s)
 {
 	int nonzero = 0;
 	int i;
+	int j;
 
 	memset(s, 0, MAX_POLY);
 
-	for (i = 0; i < npar; i++) {
-		int j;
+	/* Accumulate each byte into every syndrome at once, so that its
+	 * logarithm is looked up only once and zero bytes are skipped
+	 * entirely. The exponent log(c) + i * j is stepped by j rather
+	 * than reduced modulo 255 for every term.
+	 */
+	for (j = 0; j < bs; j++) {
+		uint8_t c = data[bs - j - 1];
+		int e;
 
-		for (j = 0; j < bs; j++) {
-			uint8_t c = data[bs - j - 1];
+		if (!c)
+			continue;
 
-			if (!c)
-				continue;
+		e = gf256_log[c];
+		for (i = 0; i < npar; i++) {
+			s[i] ^= gf256_exp[e];
 
-			s[i] ^= gf256_exp[((int)gf256_log[c] +
-				    i * j) % 255];
+			e += j;
+			if (e >= 255)
+				e -= 255;
 		}
+	}
 
+	for (i = 0; i < npar; i++)
 		if (s[i])
 			nonzero = 1;
-	}
 
 	return nonzero;
 }
@@ -285,8 +437,7 @@ static void eloc_poly(uint8_t *omega,
 			if (!b)
 				continue;
 
-			omega[i + j] ^=
-			    gf256_exp[(log_a + gf256_log[b]) % 255];
+			omega[i + j] ^= gf256_exp[log_a + gf256_log[b]];
 		}
 	}
 }
@@ -305,7 +456,7 @@ static quirc_decode_error_t correct_block(uint8_t *data,
 	if (!block_syndromes(data, ecc->bs, npar, s))
 		return QUIRC_SUCCESS;
 
-	berlekamp_massey(s, npar, &gf256, sigma);
+	berlekamp_massey_gf256(s, npar, sigma);
 
 	/* Compute derivative of sigma */
 	memset(sigma_deriv, 0, MAX_POLY);
@@ -319,11 +470,11 @@ static quirc_decode_error_t correct_block(uint8_t *data,
 	for (i = 0; i < ecc->bs; i++) {
 		uint8_t xinv = gf256_exp[255 - i];
 
-		if (!poly_eval(sigma, xinv, &gf256)) {
-			uint8_t sd_x = poly_eval(sigma_deriv, xinv, &gf256);
-			uint8_t omega_x = poly_eval(omega, xinv, &gf256);
-			uint8_t error = gf256_exp[(255 - gf256_log[sd_x] +
-						   gf256_log[omega_x]) % 255];
+		if (!poly_eval_gf256(sigma, xinv)) {
+			uint8_t sd_x = poly_eval_gf256(sigma_deriv, xinv);
+			uint8_t omega_x = poly_eval_gf256(omega, xinv);
+			uint8_t error = gf256_exp[255 - gf256_log[sd_x] +
+						  gf256_log[omega_x]];
 
 			data[ecc->bs - i - 1] ^= error;
 		}
@@ -832,6 +983,19 @@ static quirc_decode_error_t decode_eci(struct quirc_data *data,
 	return QUIRC_SUCCESS;
 }
 
+static quirc_decode_error_t decode_structured_append(struct quirc_data *data,
+						     struct datastream *ds)
+{
+	if (bits_remaining(ds) < 16)
+		return QUIRC_ERROR_DATA_UNDERFLOW;
+
+	data->sa_index = take_bits(ds, 4);
+	data->sa_size = take_bits(ds, 4) + 1;
+	data->sa_parity = take_bits(ds, 8);
+
+	return QUIRC_SUCCESS;
+}
+
 static quirc_decode_error_t decode_payload(struct quirc_data *data,
 					   struct datastream *ds)
 {
@@ -856,6 +1020,10 @@ static quirc_decode_error_t decode_payload(struct quirc_data *data,
 			err = decode_kanji(data, ds);
 			break;
 
+		case 3:
+			err = decode_structured_append(data, ds);
+			break;
+
 		case 7:
 			err = decode_eci(data, ds);
 			break;
@@ -299,50 +299,71 @@ static void flood_fill_seed(struct quirc *q, int start_x, int start_y, int from,
  */
 
 #define THRESHOLD_S_DEN		8
+#define THRESHOLD_S_MIN		1
 #define THRESHOLD_T		5
 
-static void threshold(struct quirc *q)
+/* The running averages use a power-of-two window close to
+ * w / THRESHOLD_S_DEN, so that decaying them is a shift rather than a
+ * division (there is no hardware divide on the ARM11).
+ */
+static int threshold_shift(int w)
+{
+	int threshold_s = w / THRESHOLD_S_DEN;
+	int shift = 0;
+
+	if (threshold_s < THRESHOLD_S_MIN)
+		threshold_s = THRESHOLD_S_MIN;
+
+	while ((3 << (shift + 1)) <= threshold_s * 4)
+		shift++;
+
+	return shift;
+}
+
+static void threshold(quirc_pixel_t *row, int w, int h, int *row_average)
 {
 	int x, y;
 	int avg_w = 0;
 	int avg_u = 0;
-	int threshold_s = q->w / THRESHOLD_S_DEN;
-	quirc_pixel_t *row = q->pixels;
+	int shift = threshold_shift(w);
+	int round = (1 << shift) - 1;
+	int scale = (200 << shift);
 
-	for (y = 0; y < q->h; y++) {
-		int row_average[q->w];
+	for (y = 0; y < h; y++) {
+		memset(row_average, 0, w * sizeof(int));
 
-		memset(row_average, 0, sizeof(row_average));
-
-		for (x = 0; x < q->w; x++) {
-			int w, u;
+		for (x = 0; x < w; x++) {
+			int pw, pu;
 
 			if (y & 1) {
-				w = x;
-				u = q->w - 1 - x;
+				pw = x;
+				pu = w - 1 - x;
 			} else {
-				w = q->w - 1 - x;
-				u = x;
+				pw = w - 1 - x;
+				pu = x;
 			}
 
-			avg_w = (avg_w * (threshold_s - 1)) /
-				threshold_s + row[w];
-			avg_u = (avg_u * (threshold_s - 1)) /
-				threshold_s + row[u];
+			/* avg * (s - 1) / s, rounded down, with s = 1 << shift */
+			avg_w = avg_w - ((avg_w + round) >> shift) + row[pw];
+			avg_u = avg_u - ((avg_u + round) >> shift) + row[pu];
 
-			row_average[w] += avg_w;
-			row_average[u] += avg_u;
+			row_average[pw] += avg_w;
+			row_average[pu] += avg_u;
 		}
 
-		for (x = 0; x < q->w; x++) {
-			if (row[x] < row_average[x] *
-			    (100 - THRESHOLD_T) / (200 * threshold_s))
+		/* Equivalent to
+		 *   row[x] < row_average[x] * (100 - THRESHOLD_T) / (200 * s)
+		 * without the division.
+		 */
+		for (x = 0; x < w; x++) {
+			if ((row[x] + 1) * scale <=
+			    row_average[x] * (100 - THRESHOLD_T))
 				row[x] = QUIRC_PIXEL_BLACK;
 			else
 				row[x] = QUIRC_PIXEL_WHITE;
 		}
 
-		row += q->w;
+		row += w;
 	}
 }
 
@@ -1190,6 +1211,200 @@ static void test_grouping(struct quirc *q, int i)
 	test_neighbours(q, i, &hlist, &vlist);
 }
 
+/************************************************************************
+ * Coarse detection pass
+ *
+ * Most camera frames contain no QR code at all. Before doing the full
+ * resolution work, a 2x downsampled copy of the image is binarized and
+ * scanned for finder pattern runs. The full resolution pass is then
+ * restricted to the region around the candidates.
+ *
+ * Codes with modules of about two pixels do not survive the
+ * downsampling, but the contrast it averages away does: such a code
+ * shows up as tiles full of fine detail. Frames with neither finder
+ * pattern runs nor detailed tiles are rejected outright. Every
+ * QUIRC_FULL_SCAN_INTERVAL-th frame is still scanned in full.
+ */
+
+#define QUIRC_FULL_SCAN_INTERVAL	4
+
+/* Detail is measured per tile of COARSE_TILE x COARSE_TILE downsampled
+ * pixels, as the mean of |a - d| + |b - c| over the 2x2 blocks [a b; c d]
+ * that were averaged. Sensor noise stays well below COARSE_DETAIL.
+ */
+#define COARSE_TILE			8
+#define COARSE_DETAIL			48
+
+struct coarse_roi {
+	int hits;
+	int size;
+	int x0, y0, x1, y1;
+};
+
+static void coarse_setup(struct quirc *q, struct coarse_roi *detail)
+{
+	int cw = q->w >> 1;
+	int ch = q->h >> 1;
+	int tw = cw / COARSE_TILE;
+	int *tile_detail = q->row_average;
+	int x, y;
+
+	memset(detail, 0, sizeof(*detail));
+
+	for (y = 0; y < ch; y++) {
+		const uint8_t *r0 = q->image + (y << 1) * q->w;
+		const uint8_t *r1 = r0 + q->w;
+		quirc_pixel_t *out = q->coarse + y * cw;
+
+		if (y % COARSE_TILE == 0)
+			memset(tile_detail, 0, (tw + 1) * sizeof(int));
+
+		for (x = 0; x < cw; x++) {
+			int i = x << 1;
+			int a = r0[i];
+			int b = r0[i + 1];
+			int c = r1[i];
+			int d = r1[i + 1];
+
+			out[x] = (a + b + c + d) >> 2;
+			tile_detail[x / COARSE_TILE] += abs(a - d) + abs(b - c);
+		}
+
+		if (y % COARSE_TILE != COARSE_TILE - 1)
+			continue;
+
+		for (x = 0; x < tw; x++) {
+			int tx = x * COARSE_TILE;
+			int ty = y + 1 - COARSE_TILE;
+
+			if (tile_detail[x] < COARSE_DETAIL *
+			    COARSE_TILE * COARSE_TILE)
+				continue;
+
+			if (!detail->hits || tx < detail->x0)
+				detail->x0 = tx;
+			if (!detail->hits || tx + COARSE_TILE - 1 > detail->x1)
+				detail->x1 = tx + COARSE_TILE - 1;
+			if (!detail->hits)
+				detail->y0 = ty;
+			detail->y1 = y;
+
+			detail->hits++;
+		}
+	}
+}
+
+static void coarse_finder_scan(const quirc_pixel_t *row, int w, int y,
+			       struct coarse_roi *roi)
+{
+	int x;
+	int last_color = 0;
+	int run_length = 0;
+	int run_count = 0;
+	int pb[5];
+
+	memset(pb, 0, sizeof(pb));
+	for (x = 0; x < w; x++) {
+		int color = row[x] ? 1 : 0;
+
+		if (x && color != last_color) {
+			memmove(pb, pb + 1, sizeof(pb[0]) * 4);
+			pb[4] = run_length;
+			run_length = 0;
+			run_count++;
+
+			if (!color && run_count >= 5) {
+				static int check[5] = {1, 1, 3, 1, 1};
+				int avg, err;
+				int i;
+				int ok = 1;
+
+				avg = (pb[0] + pb[1] + pb[3] + pb[4]) / 4;
+				err = avg * 3 / 4;
+
+				for (i = 0; i < 5; i++)
+					if (pb[i] < check[i] * avg - err ||
+					    pb[i] > check[i] * avg + err)
+						ok = 0;
+
+				if (ok) {
+					int size = pb[0] + pb[1] + pb[2] +
+						pb[3] + pb[4];
+					int cx = x - pb[4] - pb[3] - pb[2] / 2;
+
+					if (!roi->hits || cx < roi->x0)
+						roi->x0 = cx;
+					if (!roi->hits || cx > roi->x1)
+						roi->x1 = cx;
+					if (!roi->hits || y < roi->y0)
+						roi->y0 = y;
+					if (!roi->hits || y > roi->y1)
+						roi->y1 = y;
+					if (size > roi->size)
+						roi->size = size;
+
+					roi->hits++;
+				}
+			}
+		}
+
+		run_length++;
+		last_color = color;
+	}
+}
+
+static int clamp(int v, int lo, int hi)
+{
+	return v < lo ? lo : v > hi ? hi : v;
+}
+
+/* Returns 0 if the frame can be rejected, otherwise fills in the
+ * full-resolution rows/columns [x0, x1) x [y0, y1) worth scanning.
+ */
+static int coarse_locate(struct quirc *q, int *x0, int *y0,
+			 int *x1, int *y1)
+{
+	int cw = q->w >> 1;
+	int ch = q->h >> 1;
+	struct coarse_roi roi;
+	struct coarse_roi detail;
+	int margin_x, margin_y;
+	int y;
+
+	coarse_setup(q, &detail);
+	threshold(q->coarse, cw, ch, q->row_average);
+
+	memset(&roi, 0, sizeof(roi));
+	for (y = 0; y < ch; y++)
+		coarse_finder_scan(q->coarse + y * cw, cw, y, &roi);
+
+	if (roi.hits) {
+		/* The hits are capstone centres. The fourth corner of a
+		 * rotated code can lie up to the extent of the centres'
+		 * bounding box beyond it, plus half a capstone and a quiet
+		 * zone.
+		 */
+		margin_x = (roi.x1 - roi.x0) + roi.size;
+		margin_y = (roi.y1 - roi.y0) + roi.size;
+	} else if (detail.hits) {
+		/* No finder pattern survived, but a code too small for the
+		 * coarse pass may lie within the detailed tiles.
+		 */
+		roi = detail;
+		margin_x = COARSE_TILE;
+		margin_y = COARSE_TILE;
+	} else {
+		return 0;
+	}
+
+	*x0 = clamp((roi.x0 - margin_x) * 2, 0, q->w);
+	*x1 = clamp((roi.x1 + margin_x + 1) * 2, 0, q->w);
+	*y0 = clamp((roi.y0 - margin_y) * 2, 0, q->h);
+	*y1 = clamp((roi.y1 + margin_y + 1) * 2, 0, q->h);
+
+	return 1;
+}
+
 static void pixels_setup(struct quirc *q)
 {
 	if (sizeof(*q->image) == sizeof(*q->pixels)) {
@@ -1221,11 +1436,36 @@ uint8_t *quirc_begin(struct quirc *q, int *w, int *h)
 void quirc_end(struct quirc *q)
 {
 	int i;
+	int x0 = 0;
+	int y0 = 0;
+	int x1 = q->w;
+	int y1 = q->h;
+
+	if (q->frame++ % QUIRC_FULL_SCAN_INTERVAL &&
+	    !coarse_locate(q, &x0, &y0, &x1, &y1))
+		return;
 
 	pixels_setup(q);
-	threshold(q);
 
-	for (i = 0; i < q->h; i++)
+	/* Everything outside the region of interest is treated as white */
+	memset(q->pixels, QUIRC_PIXEL_WHITE, y0 * q->w * sizeof(quirc_pixel_t));
+	memset(q->pixels + y1 * q->w, QUIRC_PIXEL_WHITE,
+	       (q->h - y1) * q->w * sizeof(quirc_pixel_t));
+
+	threshold(q->pixels + y0 * q->w, q->w, y1 - y0, q->row_average);
+
+	if (x0 > 0 || x1 < q->w) {
+		for (i = y0; i < y1; i++) {
+			quirc_pixel_t *row = q->pixels + i * q->w;
+
+			memset(row, QUIRC_PIXEL_WHITE,
+			       x0 * sizeof(quirc_pixel_t));
+			memset(row + x1, QUIRC_PIXEL_WHITE,
+			       (q->w - x1) * sizeof(quirc_pixel_t));
+		}
+	}
+
+	for (i = y0; i < y1; i++)
 		finder_scan(q, i);
 
 	for (i = 0; i < q->num_capstones; i++)
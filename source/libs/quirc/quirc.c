@@ -40,6 +40,10 @@ void quirc_destroy(struct quirc *q)
 		free(q->image);
 	if (sizeof(*q->image) != sizeof(*q->pixels))
 		free(q->pixels);
+	if (q->row_average)
+		free(q->row_average);
+	if (q->coarse)
+		free(q->coarse);
 
 	free(q);
 }
@@ -47,10 +51,30 @@ void quirc_destroy(struct quirc *q)
 int quirc_resize(struct quirc *q, int w, int h)
 {
 	uint8_t *new_image = realloc(q->image, w * h);
+	int *new_row_average;
+	quirc_pixel_t *new_coarse;
 
 	if (!new_image)
 		return -1;
 
+	q->image = new_image;
+
+	new_row_average = realloc(q->row_average, w * sizeof(int));
+	if (!new_row_average)
+		return -1;
+
+	q->row_average = new_row_average;
+
+	/* The extra byte keeps the allocation non-empty for images under
+	 * 2 pixels wide or high, where realloc(.., 0) may return NULL.
+	 */
+	new_coarse = realloc(q->coarse, (w >> 1) * (h >> 1) *
+			     sizeof(quirc_pixel_t) + 1);
+	if (!new_coarse)
+		return -1;
+
+	q->coarse = new_coarse;
+
 	if (sizeof(*q->image) != sizeof(*q->pixels)) {
 		size_t new_size = w * h * sizeof(quirc_pixel_t);
 		quirc_pixel_t *new_pixels = realloc(q->pixels, new_size);
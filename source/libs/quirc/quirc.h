@@ -147,6 +147,16 @@ struct quirc_data {
 
 	/* ECI assignment number */
 	uint32_t		eci;
+
+	/* Structured append header. If the code is one of a sequence,
+	 * sa_size is the number of codes in the sequence (2 to 16),
+	 * sa_index is this code's position in it and sa_parity is the
+	 * XOR of every data byte in the whole sequence. sa_size is 0
+	 * for standalone codes.
+	 */
+	int			sa_index;
+	int			sa_size;
+	int			sa_parity;
 };
 
 /* Return the number of QR-codes identified in the last processed
@@ -77,6 +77,9 @@ struct quirc_grid {
 struct quirc {
 	uint8_t			*image;
 	quirc_pixel_t		*pixels;
+	int			*row_average; /* used by threshold() */
+	quirc_pixel_t		*coarse; /* 2x downsampled image */
+	unsigned int		frame; /* wraps, used for QUIRC_FULL_SCAN_INTERVAL */
 	int			w;
 	int			h;
 
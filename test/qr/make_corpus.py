@@ -0,0 +1,114 @@
+#!/usr/bin/env python
+# coding: utf-8 -*-
+
+# Regenerates the QR frame corpus used by qrbench: 400x240 grayscale PNGs with codes at various sizes,
+# angles and lighting, plus frames without any, and corpus.txt listing the payloads each frame holds.
+# Requires the qrcode package (pip install qrcode). The output is deterministic.
+
+import math
+import random
+import struct
+import zlib
+
+import qrcode
+
+WIDTH = 400
+HEIGHT = 240
+
+def write_png(path, pixels):
+    raw = b''.join(b'\x00' + bytes(pixels[y * WIDTH:(y + 1) * WIDTH]) for y in range(HEIGHT))
+
+    def chunk(kind, data):
+        return struct.pack('!L', len(data)) + kind + data + struct.pack('!L', zlib.crc32(kind + data) & 0xFFFFFFFF)
+
+    with open(path, 'wb') as f:
+        f.write(b'\x89PNG\r\n\x1a\n')
+        f.write(chunk(b'IHDR', struct.pack('!LLBBBBB', WIDTH, HEIGHT, 8, 0, 0, 0, 0)))
+        f.write(chunk(b'IDAT', zlib.compress(raw, 9)))
+        f.write(chunk(b'IEND', b''))
+
+def qr_matrix(payload):
+    code = qrcode.QRCode(error_correction=qrcode.constants.ERROR_CORRECT_M, border=4)
+    code.add_data(payload)
+    code.make(fit=True)
+    return code.get_matrix()
+
+def lighting(x, y, light):
+    # Uneven illumination: a horizontal gradient plus a soft vignette.
+    fx = x / float(WIDTH)
+    fy = (y - HEIGHT / 2.0) / HEIGHT
+    return light[0] + (light[1] - light[0]) * fx - 0.2 * fy * fy
+
+def render(codes, light=(0.9, 0.9), contrast=1.0, noise=0, blur=False):
+    pixels = [0] * (WIDTH * HEIGHT)
+
+    # Printed black is never fully dark; lower contrast lifts it further.
+    dark_level = 0.08 + (1.0 - contrast) * 0.6
+
+    prepared = []
+    for payload, cx, cy, module, angle in codes:
+        matrix = qr_matrix(payload)
+        prepared.append((matrix, len(matrix), cx, cy, module, math.cos(-angle), math.sin(-angle)))
+
+    for y in range(HEIGHT):
+        for x in range(WIDTH):
+            reflectance = 0.0
+            for sy in (0.25, 0.75):
+                for sx in (0.25, 0.75):
+                    dark = False
+                    for matrix, n, cx, cy, module, c, s in prepared:
+                        dx = x + sx - cx
+                        dy = y + sy - cy
+                        u = (dx * c - dy * s) / module + n / 2.0
+                        v = (dx * s + dy * c) / module + n / 2.0
+                        if 0 <= u < n and 0 <= v < n and matrix[int(v)][int(u)]:
+                            dark = True
+                            break
+
+                    reflectance += dark_level if dark else 1.0
+
+            value = reflectance / 4.0 * lighting(x, y, light) * 255
+            if noise:
+                value += random.uniform(-noise, noise)
+
+            pixels[y * WIDTH + x] = max(0, min(255, int(value)))
+
+    if blur:
+        blurred = list(pixels)
+        for y in range(1, HEIGHT - 1):
+            for x in range(1, WIDTH - 1):
+                total = 0
+                for oy in (-1, 0, 1):
+                    row = (y + oy) * WIDTH
+                    total += pixels[row + x - 1] + pixels[row + x] + pixels[row + x + 1]
+                blurred[y * WIDTH + x] = total // 9
+        pixels = blurred
+
+    return pixels
+
+FRAMES = [
+    ('empty_gradient.png', [], {'light': (0.5, 0.95)}),
+    ('empty_noise.png', [], {'light': (0.7, 0.8), 'noise': 12}),
+    ('small.png', [('http://192.168.1.20:8080/a.cia', 200, 120, 2.0, 0.0)], {}),
+    ('medium.png', [('http://192.168.1.20:8080/Some%20Game.cia', 200, 120, 4.0, 0.0)], {'light': (0.6, 0.95)}),
+    ('large.png', [('https://example.com/fbi/FBI.cia', 200, 120, 6.0, 0.0)], {'light': (0.95, 0.5)}),
+    ('rotated.png', [('http://10.0.0.2:8080/title.cia', 190, 125, 4.0, math.radians(25))], {}),
+    ('tilted.png', [('http://10.0.0.2:8080/update.cia', 210, 115, 3.5, math.radians(-8))], {'blur': True}),
+    ('dim.png', [('http://10.0.0.2:8080/dlc.cia', 200, 120, 4.0, 0.0)], {'light': (0.35, 0.45), 'contrast': 0.7}),
+    ('noisy.png', [('http://10.0.0.2:8080/noisy.cia', 200, 120, 4.0, math.radians(5))], {'noise': 20}),
+    ('two_codes.png', [('http://10.0.0.3:8080/left.cia', 100.5, 120.5, 3.0, 0.0), ('http://10.0.0.3:8080/right.cia', 300.5, 120.5, 3.0, 0.0)], {}),
+]
+
+def main():
+    random.seed(1)
+
+    with open('corpus.txt', 'w') as listing:
+        listing.write('# <frame> followed by the payload of every code in it, tab separated.\n')
+
+        for name, codes, options in FRAMES:
+            write_png(name, render(codes, **options))
+            listing.write('\t'.join([name] + [code[0] for code in codes]) + '\n')
+            print(name)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,120 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <3ds.h>
+
+#include "test.h"
+#include "../source/core/grayscale.h"
+#include "qrcorpus.h"
+
+// Each frame is scanned this many times in a row, as the camera would deliver it. A multiple of quirc's full
+// scan interval, so every frame sees both the coarse and the full detection pass.
+#define ITERATIONS 32
+
+typedef struct {
+    double convertMs;
+    double detectMs;
+    double decodeMs;
+
+    u32 scans;
+    u32 expected;
+    u32 decoded;
+    u32 unexpected;
+} qrbench_stats;
+
+static void qrbench_scan(struct quirc* qr, const qrcorpus_entry* entry, qrbench_stats* stats) {
+    double start = test_time_ms();
+
+    uint8_t* image = quirc_begin(qr, NULL, NULL);
+    for(int y = 0; y < entry->h; y++) {
+        grayscale_convert_rgb565_row(&image[y * entry->w], &entry->frame[y * entry->w], entry->w);
+    }
+
+    double detectStart = test_time_ms();
+
+    quirc_end(qr);
+
+    double decodeStart = test_time_ms();
+
+    stats->decoded += qrcorpus_match(qr, entry, &stats->unexpected);
+
+    double end = test_time_ms();
+
+    stats->convertMs += detectStart - start;
+    stats->detectMs += decodeStart - detectStart;
+    stats->decodeMs += end - decodeStart;
+
+    stats->scans++;
+    stats->expected += entry->payloadCount;
+}
+
+static void qrbench_print(const char* name, qrbench_stats* stats) {
+    printf("%-20s %9.1f %9.1f %9.1f   %4lu / %-4lu", name,
+           stats->convertMs * 1000 / stats->scans, stats->detectMs * 1000 / stats->scans, stats->decodeMs * 1000 / stats->scans,
+           (unsigned long) stats->decoded, (unsigned long) stats->expected);
+
+    if(stats->unexpected > 0) {
+        printf("   %lu unexpected", (unsigned long) stats->unexpected);
+    }
+
+    printf("\n");
+}
+
+int main(int argc, char** argv) {
+    const char* dir = argc > 1 ? argv[1] : "qr";
+
+    FILE* corpus = qrcorpus_open(dir);
+    if(corpus == NULL) {
+        return 1;
+    }
+
+    struct quirc* qr = quirc_new();
+    CHECK(qr != NULL);
+
+    qrbench_stats total;
+    memset(&total, 0, sizeof(total));
+
+    printf("%-20s %9s %9s %9s   %s\n", "frame", "convert", "detect", "decode", "decoded (us per scan)");
+
+    qrcorpus_entry entry;
+    while(qrcorpus_next(corpus, dir, &entry)) {
+        if(entry.frame == NULL) {
+            test_failures++;
+            continue;
+        }
+
+        CHECK(quirc_resize(qr, entry.w, entry.h) == 0);
+
+        qrbench_stats stats;
+        memset(&stats, 0, sizeof(stats));
+
+        for(int i = 0; i < ITERATIONS; i++) {
+            qrbench_scan(qr, &entry, &stats);
+        }
+
+        qrbench_print(entry.name, &stats);
+
+        // Every code must decode on every scan, coarse or full, as it did before the coarse pass; nothing else may.
+        CHECK(stats.decoded == stats.expected);
+        CHECK(stats.unexpected == 0);
+
+        total.convertMs += stats.convertMs;
+        total.detectMs += stats.detectMs;
+        total.decodeMs += stats.decodeMs;
+        total.scans += stats.scans;
+        total.expected += stats.expected;
+        total.decoded += stats.decoded;
+        total.unexpected += stats.unexpected;
+
+        free(entry.frame);
+    }
+
+    fclose(corpus);
+
+    qrbench_print("total", &total);
+    printf("decode success rate: %.1f%%\n", total.expected > 0 ? total.decoded * 100.0 / total.expected : 100.0);
+
+    quirc_destroy(qr);
+
+    return test_result("qrbench");
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <3ds.h>
+
+#include "../source/libs/quirc/quirc.h"
+#include "../source/libs/stb_image/stb_image.h"
+
+// Frames and the payloads they contain, listed in qr/corpus.txt (see qr/make_corpus.py).
+
+#define QRCORPUS_LINE_MAX 1024
+#define QRCORPUS_CODES_MAX 8
+
+typedef struct {
+    char name[QRCORPUS_LINE_MAX];
+    u16* frame;
+    int w;
+    int h;
+
+    char line[QRCORPUS_LINE_MAX];
+    char* payloads[QRCORPUS_CODES_MAX];
+    int payloadCount;
+} qrcorpus_entry;
+
+static inline FILE* qrcorpus_open(const char* dir) {
+    char path[QRCORPUS_LINE_MAX];
+    snprintf(path, sizeof(path), "%s/corpus.txt", dir);
+
+    FILE* corpus = fopen(path, "r");
+    if(corpus == NULL) {
+        fprintf(stderr, "failed to open %s\n", path);
+    }
+
+    return corpus;
+}
+
+// Packs an RGB image into the RGB565 format delivered by the camera.
+static inline u16* qrcorpus_load_frame(const char* path, int* w, int* h) {
+    int comp = 0;
+    u8* rgb = stbi_load(path, w, h, &comp, 3);
+    if(rgb == NULL) {
+        return NULL;
+    }
+
+    u16* frame = (u16*) malloc(*w * *h * sizeof(u16));
+    for(int i = 0; i < *w * *h; i++) {
+        frame[i] = (u16) (((rgb[i * 3] >> 3) << 11) | ((rgb[i * 3 + 1] >> 2) << 5) | (rgb[i * 3 + 2] >> 3));
+    }
+
+    stbi_image_free(rgb);
+    return frame;
+}
+
+// Reads the next entry and loads its frame, leaving frame NULL if it fails to load. Returns false at the end of the
+// corpus.
+static inline bool qrcorpus_next(FILE* corpus, const char* dir, qrcorpus_entry* entry) {
+    while(fgets(entry->line, sizeof(entry->line), corpus) != NULL) {
+        entry->line[strcspn(entry->line, "\r\n")] = '\0';
+        if(entry->line[0] == '#' || entry->line[0] == '\0') {
+            continue;
+        }
+
+        char* field = strtok(entry->line, "\t");
+        snprintf(entry->name, sizeof(entry->name), "%s", field);
+
+        entry->payloadCount = 0;
+        while((field = strtok(NULL, "\t")) != NULL && entry->payloadCount < QRCORPUS_CODES_MAX) {
+            entry->payloads[entry->payloadCount++] = field;
+        }
+
+        char path[QRCORPUS_LINE_MAX * 2];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->name);
+
+        entry->frame = qrcorpus_load_frame(path, &entry->w, &entry->h);
+        if(entry->frame == NULL) {
+            fprintf(stderr, "failed to load %s\n", path);
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+// Decodes every code located by the last quirc_end() and matches it against the entry's payloads. Returns the
+// number of expected payloads found; codes that decode to anything else are counted in unexpected.
+static inline u32 qrcorpus_match(struct quirc* qr, const qrcorpus_entry* entry, u32* unexpected) {
+    bool found[QRCORPUS_CODES_MAX] = {false};
+    u32 decoded = 0;
+
+    int count = quirc_count(qr);
+    for(int i = 0; i < count; i++) {
+        struct quirc_code code;
+        struct quirc_data data;
+
+        quirc_extract(qr, i, &code);
+        if(quirc_decode(&code, &data) != QUIRC_SUCCESS) {
+            continue;
+        }
+
+        bool known = false;
+        for(int j = 0; j < entry->payloadCount; j++) {
+            if(!found[j] && strcmp((const char*) data.payload, entry->payloads[j]) == 0) {
+                found[j] = true;
+                known = true;
+                break;
+            }
+        }
+
+        if(known) {
+            decoded++;
+        } else {
+            (*unexpected)++;
+        }
+    }
+
+    return decoded;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdio.h>
+#include <time.h>
+
+static int test_failures;
+
+#define CHECK(cond) do { \
+    if(!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        test_failures++; \
+    } \
+} while(0)
+
+static inline double test_time_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static inline int test_result(const char* name) {
+    if(test_failures > 0) {
+        printf("%s: %d check(s) failed\n", name, test_failures);
+        return 1;
+    }
+
+    printf("%s: passed\n", name);
+    return 0;
+}
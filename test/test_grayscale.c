@@ -0,0 +1,115 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <3ds.h>
+
+#include "test.h"
+#include "../source/core/grayscale.h"
+
+#define FRAME_WIDTH 400
+#define FRAME_HEIGHT 240
+
+// The per-pixel formula the row converter replaced.
+static u8 reference_gray(u16 px) {
+    return (u8) (((((px >> 11) & 0x1F) << 3) + (((px >> 5) & 0x3F) << 2) + ((px & 0x1F) << 3)) / 3);
+}
+
+// The previous frame conversion: column-first, dividing per pixel.
+static void reference_convert_frame(u8* dst, const u16* src, int w, int h) {
+    for(int x = 0; x < w; x++) {
+        for(int y = 0; y < h; y++) {
+            dst[y * w + x] = reference_gray(src[y * w + x]);
+        }
+    }
+}
+
+static void test_exhaustive() {
+    static u16 src[0x10000];
+    static u8 dst[0x10000];
+
+    for(u32 i = 0; i < 0x10000; i++) {
+        src[i] = (u16) i;
+    }
+
+    grayscale_convert_rgb565_row(dst, src, 0x10000);
+
+    u32 mismatches = 0;
+    for(u32 i = 0; i < 0x10000; i++) {
+        if(dst[i] != reference_gray((u16) i)) {
+            mismatches++;
+        }
+    }
+
+    CHECK(mismatches == 0);
+}
+
+// Short widths at unaligned source and destination offsets, writing nothing outside the row.
+static void test_widths() {
+    u16 src[32];
+    u8 dst[40];
+
+    for(int offset = 0; offset < 4; offset++) {
+        for(int width = 0; width <= 16; width++) {
+            for(int i = 0; i < 32; i++) {
+                src[i] = (u16) rand();
+            }
+
+            memset(dst, 0xAA, sizeof(dst));
+            grayscale_convert_rgb565_row(dst + offset, src + offset, width);
+
+            for(int i = 0; i < (int) sizeof(dst); i++) {
+                if(i >= offset && i < offset + width) {
+                    CHECK(dst[i] == reference_gray(src[i]));
+                } else {
+                    CHECK(dst[i] == 0xAA);
+                }
+            }
+        }
+    }
+}
+
+static void bench_frame() {
+    u16* src = (u16*) malloc(FRAME_WIDTH * FRAME_HEIGHT * sizeof(u16));
+    u8* expected = (u8*) malloc(FRAME_WIDTH * FRAME_HEIGHT);
+    u8* actual = (u8*) malloc(FRAME_WIDTH * FRAME_HEIGHT);
+
+    for(int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; i++) {
+        src[i] = (u16) rand();
+    }
+
+    const int iterations = 500;
+
+    double start = test_time_ms();
+    for(int i = 0; i < iterations; i++) {
+        reference_convert_frame(expected, src, FRAME_WIDTH, FRAME_HEIGHT);
+    }
+
+    double referenceMs = (test_time_ms() - start) / iterations;
+
+    start = test_time_ms();
+    for(int i = 0; i < iterations; i++) {
+        for(int y = 0; y < FRAME_HEIGHT; y++) {
+            grayscale_convert_rgb565_row(&actual[y * FRAME_WIDTH], &src[y * FRAME_WIDTH], FRAME_WIDTH);
+        }
+    }
+
+    double rowMs = (test_time_ms() - start) / iterations;
+
+    CHECK(memcmp(expected, actual, FRAME_WIDTH * FRAME_HEIGHT) == 0);
+
+    printf("grayscale: %dx%d frame, column-first divide %.3f ms, row converter %.3f ms\n", FRAME_WIDTH, FRAME_HEIGHT, referenceMs, rowMs);
+
+    free(src);
+    free(expected);
+    free(actual);
+}
+
+int main() {
+    srand(1);
+
+    test_exhaustive();
+    test_widths();
+    bench_frame();
+
+    return test_result("grayscale");
+}
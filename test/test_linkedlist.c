@@ -0,0 +1,280 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <3ds.h>
+
+#include "test.h"
+#include "../source/core/linkedlist.h"
+
+#define ITEMS_MAX 2048
+
+#define NAME_MAX 0x100
+#define BENCHMARK_ITEMS 2000
+
+typedef struct {
+    int key;
+    // Position in the input, to tell equal keys apart.
+    int seq;
+    char name[NAME_MAX];
+} item;
+
+// userData counts the comparisons made, if not NULL.
+static int compare_keys(void* userData, const void* p1, const void* p2) {
+    if(userData != NULL) {
+        (*(u32*) userData)++;
+    }
+
+    return ((const item*) p1)->key - ((const item*) p2)->key;
+}
+
+static int compare_names(void* userData, const void* p1, const void* p2) {
+    (*(u32*) userData)++;
+
+    return strncasecmp(((const item*) p1)->name, ((const item*) p2)->name, NAME_MAX);
+}
+
+// Orders by key, then by input position: the order a stable sort must produce.
+static int compare_stable(const void* p1, const void* p2) {
+    const item* i1 = *(const item**) p1;
+    const item* i2 = *(const item**) p2;
+
+    if(i1->key != i2->key) {
+        return i1->key - i2->key;
+    }
+
+    return i1->seq - i2->seq;
+}
+
+// The previous sort: bubble sort, swapping values until a pass makes no swaps.
+static void reference_sort(linked_list* list, void* userData, int (*compare)(void* userData, const void* p1, const void* p2)) {
+    bool swapped = true;
+    while(swapped) {
+        swapped = false;
+
+        linked_list_node* curr = list->first;
+        if(curr == NULL) {
+            return;
+        }
+
+        linked_list_node* next = NULL;
+        while((next = curr->next) != NULL) {
+            if(compare(userData, curr->value, next->value) > 0) {
+                void* temp = curr->value;
+                curr->value = next->value;
+                next->value = temp;
+
+                swapped = true;
+            }
+
+            curr = next;
+        }
+    }
+}
+
+// Fills items with keys following the given pattern; few distinct keys so that there are many ties.
+static void fill_items(item* items, int count, int pattern) {
+    for(int i = 0; i < count; i++) {
+        items[i].seq = i;
+
+        switch(pattern) {
+            case 0:
+                items[i].key = rand() % 8;
+                break;
+            case 1:
+                items[i].key = i / 3;
+                break;
+            case 2:
+                items[i].key = (count - i) / 3;
+                break;
+            default:
+                items[i].key = 0;
+                break;
+        }
+    }
+}
+
+// Checks that the list holds exactly the expected values in order, with consistent links, last and size.
+static bool check_list(linked_list* list, item** expected, int count) {
+    bool ok = linked_list_size(list) == (unsigned int) count;
+
+    int i = 0;
+    linked_list_node* prev = NULL;
+    for(linked_list_node* node = list->first; node != NULL && ok; node = node->next) {
+        ok = i < count && node->value == expected[i] && node->prev == prev;
+
+        prev = node;
+        i++;
+    }
+
+    return ok && i == count && list->last == prev;
+}
+
+static void test_sort() {
+    static item items[ITEMS_MAX];
+    static item* expected[ITEMS_MAX];
+
+    static const int sizes[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 31, 32, 33, 100, 1000, ITEMS_MAX};
+
+    srand(1);
+
+    for(u32 s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int count = sizes[s];
+
+        for(int pattern = 0; pattern < 4; pattern++) {
+            fill_items(items, count, pattern);
+
+            linked_list list;
+            linked_list_init(&list);
+
+            for(int i = 0; i < count; i++) {
+                linked_list_add(&list, &items[i]);
+                expected[i] = &items[i];
+            }
+
+            qsort(expected, (size_t) count, sizeof(item*), compare_stable);
+
+            unsigned int indexVersion = linked_list_index_version(&list);
+
+            linked_list_sort(&list, NULL, compare_keys);
+
+            CHECK(check_list(&list, expected, count));
+
+            // Views refresh their indices only when this changes.
+            if(count > 1) {
+                CHECK(linked_list_index_version(&list) != indexVersion);
+            }
+
+            linked_list_destroy(&list);
+        }
+    }
+}
+
+static void test_merge_sorted() {
+    static item items[ITEMS_MAX];
+    static item* expected[ITEMS_MAX];
+
+    static const int sizes[] = {0, 1, 2, 5, 64, 1000};
+
+    srand(2);
+
+    for(u32 a = 0; a < sizeof(sizes) / sizeof(sizes[0]); a++) {
+        for(u32 b = 0; b < sizeof(sizes) / sizeof(sizes[0]); b++) {
+            int listCount = sizes[a];
+            int valueCount = sizes[b];
+
+            fill_items(items, listCount + valueCount, 0);
+
+            linked_list list;
+            linked_list values;
+            linked_list reference;
+            linked_list_init(&list);
+            linked_list_init(&values);
+            linked_list_init(&reference);
+
+            for(int i = 0; i < listCount; i++) {
+                linked_list_add_sorted(&list, &items[i], NULL, compare_keys);
+                linked_list_add_sorted(&reference, &items[i], NULL, compare_keys);
+            }
+
+            for(int i = listCount; i < listCount + valueCount; i++) {
+                linked_list_add(&values, &items[i]);
+                linked_list_add_sorted(&reference, &items[i], NULL, compare_keys);
+            }
+
+            linked_list_merge_sorted(&list, &values, NULL, compare_keys);
+
+            // Same order as adding each value with linked_list_add_sorted.
+            int i = 0;
+            for(linked_list_node* node = reference.first; node != NULL; node = node->next) {
+                expected[i++] = (item*) node->value;
+            }
+
+            CHECK(check_list(&list, expected, listCount + valueCount));
+            CHECK(check_list(&values, NULL, 0));
+
+            linked_list_destroy(&reference);
+            linked_list_destroy(&values);
+            linked_list_destroy(&list);
+        }
+    }
+
+    // Without a comparator the values are appended in order.
+    fill_items(items, 6, 0);
+
+    linked_list list;
+    linked_list values;
+    linked_list_init(&list);
+    linked_list_init(&values);
+
+    for(int i = 0; i < 6; i++) {
+        linked_list_add(i < 3 ? &list : &values, &items[i]);
+        expected[i] = &items[i];
+    }
+
+    linked_list_merge_sorted(&list, &values, NULL, NULL);
+
+    CHECK(check_list(&list, expected, 6));
+    CHECK(check_list(&values, NULL, 0));
+
+    linked_list_destroy(&values);
+    linked_list_destroy(&list);
+}
+
+// Sorts names as the title and file lists do, with the merge sort and the previous bubble sort.
+static void benchmark_sort() {
+    static item items[BENCHMARK_ITEMS];
+
+    srand(3);
+
+    for(int i = 0; i < BENCHMARK_ITEMS; i++) {
+        // Long shared prefixes and duplicates, like file names in one directory.
+        snprintf(items[i].name, NAME_MAX, "%s/Game %04d (%s).cia", "sdmc:/cias", rand() % (BENCHMARK_ITEMS / 2),
+                 rand() % 2 ? "USA" : "EUR");
+    }
+
+    linked_list list;
+    linked_list reference;
+    linked_list_init(&list);
+    linked_list_init(&reference);
+
+    for(int i = 0; i < BENCHMARK_ITEMS; i++) {
+        linked_list_add(&list, &items[i]);
+        linked_list_add(&reference, &items[i]);
+    }
+
+    u32 sortComparisons = 0;
+    double start = test_time_ms();
+    linked_list_sort(&list, &sortComparisons, compare_names);
+    double sortMs = test_time_ms() - start;
+
+    u32 referenceComparisons = 0;
+    start = test_time_ms();
+    reference_sort(&reference, &referenceComparisons, compare_names);
+    double referenceMs = test_time_ms() - start;
+
+    // Both are stable, so the results match node for node.
+    bool same = true;
+    for(linked_list_node* a = list.first, *b = reference.first; a != NULL || b != NULL; a = a->next, b = b->next) {
+        if(a == NULL || b == NULL || a->value != b->value) {
+            same = false;
+            break;
+        }
+    }
+
+    CHECK(same);
+
+    printf("linkedlist: %d names, merge sort %.2f ms (%lu compares), bubble sort %.2f ms (%lu compares)\n", BENCHMARK_ITEMS,
+           sortMs, (unsigned long) sortComparisons, referenceMs, (unsigned long) referenceComparisons);
+
+    linked_list_destroy(&reference);
+    linked_list_destroy(&list);
+}
+
+int main() {
+    test_sort();
+    test_merge_sorted();
+    benchmark_sort();
+
+    return test_result("linkedlist");
+}
@@ -0,0 +1,327 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <3ds.h>
+
+#include "test.h"
+
+// The Reed-Solomon code is static, so the test builds decode.c into itself.
+#include "../source/libs/quirc/decode.c"
+
+// Largest block and parity sizes used by any QR version.
+#define BLOCK_MAX 153
+#define PARITY_MAX 30
+
+#define BLOCKS 20000
+
+// The benchmark keeps the fastest of this many interleaved runs, as host timings are noisy.
+#define BENCHMARK_ROUNDS 7
+
+// Upstream quirc's syndrome computation, reducing every exponent modulo 255.
+static int reference_block_syndromes(const uint8_t* data, int bs, int npar, uint8_t* s) {
+    int nonzero = 0;
+
+    memset(s, 0, MAX_POLY);
+
+    for(int i = 0; i < npar; i++) {
+        for(int j = 0; j < bs; j++) {
+            uint8_t c = data[bs - j - 1];
+            if(!c) {
+                continue;
+            }
+
+            s[i] ^= gf256_exp[((int) gf256_log[c] + i * j) % 255];
+        }
+
+        if(s[i]) {
+            nonzero = 1;
+        }
+    }
+
+    return nonzero;
+}
+
+static void reference_eloc_poly(uint8_t* omega, const uint8_t* s, const uint8_t* sigma, int npar) {
+    memset(omega, 0, MAX_POLY);
+
+    for(int i = 0; i < npar; i++) {
+        uint8_t a = sigma[i];
+        uint8_t log_a = gf256_log[a];
+
+        if(!a) {
+            continue;
+        }
+
+        for(int j = 0; j + 1 < MAX_POLY; j++) {
+            uint8_t b = s[j + 1];
+
+            if(i + j >= npar) {
+                break;
+            }
+
+            if(!b) {
+                continue;
+            }
+
+            omega[i + j] ^= gf256_exp[(log_a + gf256_log[b]) % 255];
+        }
+    }
+}
+
+// Upstream quirc's correct_block, going through the generic poly_eval.
+static quirc_decode_error_t reference_correct_block(uint8_t* data, const struct quirc_rs_params* ecc) {
+    int npar = ecc->bs - ecc->dw;
+    uint8_t s[MAX_POLY];
+    uint8_t sigma[MAX_POLY];
+    uint8_t sigma_deriv[MAX_POLY];
+    uint8_t omega[MAX_POLY];
+
+    if(!reference_block_syndromes(data, ecc->bs, npar, s)) {
+        return QUIRC_SUCCESS;
+    }
+
+    berlekamp_massey(s, npar, &gf256, sigma);
+
+    memset(sigma_deriv, 0, MAX_POLY);
+    for(int i = 0; i + 1 < MAX_POLY; i += 2) {
+        sigma_deriv[i] = sigma[i + 1];
+    }
+
+    reference_eloc_poly(omega, s, sigma, npar - 1);
+
+    for(int i = 0; i < ecc->bs; i++) {
+        uint8_t xinv = gf256_exp[255 - i];
+
+        if(!poly_eval(sigma, xinv, &gf256)) {
+            uint8_t sd_x = poly_eval(sigma_deriv, xinv, &gf256);
+            uint8_t omega_x = poly_eval(omega, xinv, &gf256);
+            uint8_t error = gf256_exp[(255 - gf256_log[sd_x] + gf256_log[omega_x]) % 255];
+
+            data[ecc->bs - i - 1] ^= error;
+        }
+    }
+
+    if(reference_block_syndromes(data, ecc->bs, npar, s)) {
+        return QUIRC_ERROR_DATA_ECC;
+    }
+
+    return QUIRC_SUCCESS;
+}
+
+static uint8_t gf256_mul(uint8_t a, uint8_t b) {
+    if(!a || !b) {
+        return 0;
+    }
+
+    return gf256_exp[(gf256_log[a] + gf256_log[b]) % 255];
+}
+
+// Appends npar parity bytes to dw data bytes, using the generator polynomial with roots a^0 .. a^(npar - 1).
+static void rs_encode(uint8_t* data, int dw, int npar) {
+    uint8_t generator[PARITY_MAX + 1] = {1};
+
+    for(int i = 0; i < npar; i++) {
+        uint8_t root = gf256_exp[i];
+
+        for(int j = i + 1; j > 0; j--) {
+            generator[j] = generator[j - 1] ^ gf256_mul(generator[j], root);
+        }
+
+        generator[0] = gf256_mul(generator[0], root);
+    }
+
+    uint8_t remainder[PARITY_MAX] = {0};
+    for(int i = 0; i < dw; i++) {
+        uint8_t factor = data[i] ^ remainder[npar - 1];
+
+        for(int j = npar - 1; j > 0; j--) {
+            remainder[j] = remainder[j - 1] ^ gf256_mul(factor, generator[j]);
+        }
+
+        remainder[0] = gf256_mul(factor, generator[0]);
+    }
+
+    for(int i = 0; i < npar; i++) {
+        data[dw + i] = remainder[npar - 1 - i];
+    }
+}
+
+// Fills a random encoded block and damages up to errors bytes of it.
+static void random_block(uint8_t* data, uint8_t* original, struct quirc_rs_params* ecc, int* errors) {
+    int npar = (rand() % (PARITY_MAX / 2) + 1) * 2;
+
+    ecc->dw = rand() % (BLOCK_MAX - npar) + 1;
+    ecc->bs = ecc->dw + npar;
+    ecc->ce = npar / 2;
+
+    for(int i = 0; i < ecc->dw; i++) {
+        // Some zero bytes, which the syndrome computation skips.
+        data[i] = (uint8_t) (rand() % 4 == 0 ? 0 : rand());
+    }
+
+    rs_encode(data, ecc->dw, npar);
+    memcpy(original, data, ecc->bs);
+
+    // Half the blocks are clean, the rest get up to one more error than can be corrected.
+    *errors = rand() % 2 ? 0 : rand() % (ecc->ce + 2);
+    for(int i = 0; i < *errors; i++) {
+        data[rand() % ecc->bs] ^= (uint8_t) (rand() % 255 + 1);
+    }
+}
+
+static void test_exp_table() {
+    for(int i = 0; i <= 256; i++) {
+        CHECK(gf256_exp[i + 255] == gf256_exp[i]);
+    }
+
+    // log(1) is stored as 255 rather than 0, so sums of two logarithms reach 510.
+    for(int i = 0; i < 255; i++) {
+        CHECK(gf256_log[gf256_exp[i]] % 255 == i);
+    }
+}
+
+static void test_poly_eval() {
+    uint8_t poly[MAX_POLY];
+    u32 mismatches = 0;
+
+    srand(1);
+
+    for(int round = 0; round < 256; round++) {
+        // From dense to mostly zero, including the zero polynomial.
+        for(int i = 0; i < MAX_POLY; i++) {
+            poly[i] = (uint8_t) (rand() % 8 < round % 9 ? rand() : 0);
+        }
+
+        for(int x = 0; x < 256; x++) {
+            if(poly_eval_gf256(poly, (uint8_t) x) != poly_eval(poly, (uint8_t) x, &gf256)) {
+                mismatches++;
+            }
+        }
+    }
+
+    CHECK(mismatches == 0);
+}
+
+static void test_berlekamp_massey() {
+    uint8_t s[MAX_POLY];
+    uint8_t sigma[MAX_POLY];
+    uint8_t expected[MAX_POLY];
+    u32 mismatches = 0;
+
+    srand(4);
+
+    for(int round = 0; round < BLOCKS; round++) {
+        int npar = (rand() % (PARITY_MAX / 2) + 1) * 2;
+
+        // Random syndromes with some zero terms, which both versions skip.
+        memset(s, 0, sizeof(s));
+        for(int i = 0; i < npar; i++) {
+            s[i] = (uint8_t) (rand() % 4 == 0 ? 0 : rand());
+        }
+
+        berlekamp_massey_gf256(s, npar, sigma);
+        berlekamp_massey(s, npar, &gf256, expected);
+
+        if(memcmp(sigma, expected, MAX_POLY) != 0) {
+            mismatches++;
+        }
+    }
+
+    CHECK(mismatches == 0);
+}
+
+static void test_correct_block() {
+    uint8_t data[BLOCK_MAX];
+    uint8_t expected[BLOCK_MAX];
+    uint8_t original[BLOCK_MAX];
+    uint8_t s[MAX_POLY];
+    uint8_t expectedS[MAX_POLY];
+
+    u32 syndromeMismatches = 0;
+    u32 mismatches = 0;
+    u32 uncorrected = 0;
+
+    srand(2);
+
+    for(int i = 0; i < BLOCKS; i++) {
+        struct quirc_rs_params ecc;
+        int errors = 0;
+        random_block(data, original, &ecc, &errors);
+        memcpy(expected, data, ecc.bs);
+
+        int npar = ecc.bs - ecc.dw;
+        if(block_syndromes(data, ecc.bs, npar, s) != reference_block_syndromes(data, ecc.bs, npar, expectedS)
+           || memcmp(s, expectedS, npar) != 0) {
+            syndromeMismatches++;
+        }
+
+        quirc_decode_error_t result = correct_block(data, &ecc);
+        quirc_decode_error_t expectedResult = reference_correct_block(expected, &ecc);
+
+        if(result != expectedResult || memcmp(data, expected, ecc.bs) != 0) {
+            mismatches++;
+        }
+
+        if(errors <= ecc.ce && (result != QUIRC_SUCCESS || memcmp(data, original, ecc.bs) != 0)) {
+            uncorrected++;
+        }
+    }
+
+    CHECK(syndromeMismatches == 0);
+    CHECK(mismatches == 0);
+    CHECK(uncorrected == 0);
+}
+
+static void benchmark_correct_block() {
+    static uint8_t blocks[BLOCKS][BLOCK_MAX];
+    static uint8_t work[BLOCKS][BLOCK_MAX];
+    static struct quirc_rs_params params[BLOCKS];
+    uint8_t original[BLOCK_MAX];
+
+    srand(3);
+
+    for(int i = 0; i < BLOCKS; i++) {
+        int errors = 0;
+        random_block(blocks[i], original, &params[i], &errors);
+    }
+
+    double referenceMs = 0;
+    double currentMs = 0;
+    for(int round = 0; round < BENCHMARK_ROUNDS; round++) {
+        memcpy(work, blocks, sizeof(work));
+
+        double start = test_time_ms();
+        for(int i = 0; i < BLOCKS; i++) {
+            reference_correct_block(work[i], &params[i]);
+        }
+        double ms = test_time_ms() - start;
+
+        if(round == 0 || ms < referenceMs) {
+            referenceMs = ms;
+        }
+
+        memcpy(work, blocks, sizeof(work));
+
+        start = test_time_ms();
+        for(int i = 0; i < BLOCKS; i++) {
+            correct_block(work[i], &params[i]);
+        }
+        ms = test_time_ms() - start;
+
+        if(round == 0 || ms < currentMs) {
+            currentMs = ms;
+        }
+    }
+
+    printf("rs: %d blocks, half damaged: upstream %.3f ms, current %.3f ms\n", BLOCKS, referenceMs, currentMs);
+}
+
+int main() {
+    test_exp_table();
+    test_poly_eval();
+    test_berlekamp_massey();
+    test_correct_block();
+    benchmark_correct_block();
+
+    return test_result("rs");
+}
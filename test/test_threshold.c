@@ -0,0 +1,235 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <3ds.h>
+
+#include "test.h"
+#include "../source/core/grayscale.h"
+#include "qrcorpus.h"
+
+// threshold() and the detection stages are static, so the test builds identify.c into itself.
+#include "../source/libs/quirc/identify.c"
+
+#define ITERATIONS 64
+
+// Upstream quirc's threshold, with the window passed in: upstream uses w / 8 and divides per pixel. With
+// s = 1 << threshold_shift(w) it must binarize exactly like threshold().
+static void reference_threshold(quirc_pixel_t* row, int w, int h, int s, int* row_average) {
+    int avg_w = 0;
+    int avg_u = 0;
+
+    for(int y = 0; y < h; y++) {
+        memset(row_average, 0, w * sizeof(int));
+
+        for(int x = 0; x < w; x++) {
+            int pw = (y & 1) ? x : w - 1 - x;
+            int pu = (y & 1) ? w - 1 - x : x;
+
+            avg_w = (avg_w * (s - 1)) / s + row[pw];
+            avg_u = (avg_u * (s - 1)) / s + row[pu];
+
+            row_average[pw] += avg_w;
+            row_average[pu] += avg_u;
+        }
+
+        for(int x = 0; x < w; x++) {
+            if(row[x] < row_average[x] * (100 - THRESHOLD_T) / (200 * s)) {
+                row[x] = QUIRC_PIXEL_BLACK;
+            } else {
+                row[x] = QUIRC_PIXEL_WHITE;
+            }
+        }
+
+        row += w;
+    }
+}
+
+static int reference_window(int w) {
+    int s = w / THRESHOLD_S_DEN;
+    return s < THRESHOLD_S_MIN ? THRESHOLD_S_MIN : s;
+}
+
+static void test_window() {
+    CHECK(threshold_shift(400) == 6);
+
+    // The window is the power of two nearest the upstream one.
+    for(int w = 1; w <= 4096; w++) {
+        int s = reference_window(w);
+        int p = 1 << threshold_shift(w);
+
+        CHECK(abs(s - p) <= abs(s - p * 2));
+        CHECK(p == 1 || abs(s - p) <= abs(s - p / 2));
+    }
+}
+
+static void test_equivalence_random() {
+    static const int widths[] = {1, 2, 3, 7, 8, 15, 16, 17, 63, 200, 400, 401, 640};
+
+    int rowAverage[640];
+    quirc_pixel_t image[640 * 8];
+    quirc_pixel_t expected[640 * 8];
+
+    srand(1);
+
+    for(u32 i = 0; i < sizeof(widths) / sizeof(widths[0]); i++) {
+        int w = widths[i];
+        int h = 8;
+
+        for(int round = 0; round < 16; round++) {
+            // Alternate between uniform noise and a dark/light pattern with a little noise on top.
+            for(int p = 0; p < w * h; p++) {
+                if(round & 1) {
+                    image[p] = (quirc_pixel_t) (((p / 3) & 1 ? 200 : 40) + rand() % 16);
+                } else {
+                    image[p] = (quirc_pixel_t) (rand() & 0xFF);
+                }
+            }
+
+            memcpy(expected, image, w * h);
+
+            threshold(image, w, h, rowAverage);
+            reference_threshold(expected, w, h, 1 << threshold_shift(w), rowAverage);
+
+            CHECK(memcmp(image, expected, w * h) == 0);
+        }
+    }
+}
+
+static void convert_frame(u8* dst, const qrcorpus_entry* entry) {
+    for(int y = 0; y < entry->h; y++) {
+        grayscale_convert_rgb565_row(&dst[y * entry->w], &entry->frame[y * entry->w], entry->w);
+    }
+}
+
+// The full-resolution detection pass of quirc_end(), with either the current threshold (s = 0) or the reference
+// one with window s.
+static void full_scan(struct quirc* q, const qrcorpus_entry* entry, int s) {
+    quirc_begin(q, NULL, NULL);
+    convert_frame(q->image, entry);
+
+    pixels_setup(q);
+
+    if(s > 0) {
+        reference_threshold(q->pixels, q->w, q->h, s, q->row_average);
+    } else {
+        threshold(q->pixels, q->w, q->h, q->row_average);
+    }
+
+    for(int y = 0; y < q->h; y++) {
+        finder_scan(q, y);
+    }
+
+    for(int i = 0; i < q->num_capstones; i++) {
+        test_grouping(q, i);
+    }
+}
+
+static void test_corpus(const char* dir) {
+    FILE* corpus = qrcorpus_open(dir);
+    if(corpus == NULL) {
+        test_failures++;
+        return;
+    }
+
+    struct quirc* q = quirc_new();
+    CHECK(q != NULL);
+
+    u32 totalPixels = 0;
+    u32 totalChanged = 0;
+    u32 totalExpected = 0;
+    u32 totalReference = 0;
+    u32 totalCurrent = 0;
+
+    printf("%-20s %11s %11s %9s   %s\n", "frame", "upstream ms", "current ms", "changed", "decoded upstream / current");
+
+    qrcorpus_entry entry;
+    while(qrcorpus_next(corpus, dir, &entry)) {
+        if(entry.frame == NULL) {
+            test_failures++;
+            continue;
+        }
+
+        CHECK(quirc_resize(q, entry.w, entry.h) == 0);
+
+        int w = entry.w;
+        int h = entry.h;
+        int s = reference_window(w);
+
+        u8* gray = (u8*) malloc(w * h);
+        u8* reference = (u8*) malloc(w * h);
+        u8* current = (u8*) malloc(w * h);
+        int* rowAverage = (int*) malloc(w * sizeof(int));
+
+        convert_frame(gray, &entry);
+
+        double referenceMs = 0;
+        double currentMs = 0;
+        for(int i = 0; i < ITERATIONS; i++) {
+            memcpy(reference, gray, w * h);
+
+            double start = test_time_ms();
+            reference_threshold(reference, w, h, s, rowAverage);
+            referenceMs += test_time_ms() - start;
+
+            memcpy(current, gray, w * h);
+
+            start = test_time_ms();
+            threshold(current, w, h, rowAverage);
+            currentMs += test_time_ms() - start;
+        }
+
+        // The current threshold is exactly the upstream one with its power-of-two window.
+        convert_frame(gray, &entry);
+        reference_threshold(gray, w, h, 1 << threshold_shift(w), rowAverage);
+        CHECK(memcmp(gray, current, w * h) == 0);
+
+        u32 changed = 0;
+        for(int p = 0; p < w * h; p++) {
+            if(reference[p] != current[p]) {
+                changed++;
+            }
+        }
+
+        u32 unexpected = 0;
+
+        full_scan(q, &entry, s);
+        u32 referenceDecoded = qrcorpus_match(q, &entry, &unexpected);
+
+        full_scan(q, &entry, 0);
+        u32 currentDecoded = qrcorpus_match(q, &entry, &unexpected);
+
+        printf("%-20s %11.3f %11.3f %8.2f%%   %d / %d of %d\n", entry.name, referenceMs / ITERATIONS, currentMs / ITERATIONS,
+               changed * 100.0 / (w * h), (int) referenceDecoded, (int) currentDecoded, entry.payloadCount);
+
+        // The window change must not lose a code the upstream threshold finds.
+        CHECK(currentDecoded >= referenceDecoded);
+        CHECK(unexpected == 0);
+
+        totalPixels += w * h;
+        totalChanged += changed;
+        totalExpected += entry.payloadCount;
+        totalReference += referenceDecoded;
+        totalCurrent += currentDecoded;
+
+        free(rowAverage);
+        free(current);
+        free(reference);
+        free(gray);
+        free(entry.frame);
+    }
+
+    fclose(corpus);
+
+    printf("%d of %d pixels binarize differently, decoded %d / %d of %d\n", (int) totalChanged, (int) totalPixels,
+           (int) totalReference, (int) totalCurrent, (int) totalExpected);
+
+    quirc_destroy(q);
+}
+
+int main(int argc, char** argv) {
+    test_window();
+    test_equivalence_random();
+    test_corpus(argc > 1 ? argv[1] : "qr");
+
+    return test_result("threshold");
+}